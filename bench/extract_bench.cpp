@@ -0,0 +1,108 @@
+// Микробенчмарк разбора ответов: прежние std::regex против ручных сканеров
+// из core/text_extract.h. Заодно проверяет, что результаты совпадают.
+//
+//   muzloto_extract_bench [iterations]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "text_extract.h"
+
+namespace {
+
+std::string regex_rating(const std::string &text) {
+  std::regex rating_regex(R"((10|[1-9]))");
+  std::smatch match;
+  if (std::regex_search(text, match, rating_regex)) {
+    return match.str();
+  }
+  return "";
+}
+
+std::string regex_phone(const std::string &text) {
+  std::regex phone_regex(
+      R"((\+7|8)[\s\-\(]?(\d{3})[\s\-\)]?(\d{3})[\s\-]?(\d{2})[\s\-]?(\d{2}))");
+  std::smatch match;
+  if (std::regex_search(text, match, phone_regex)) {
+    return match.str();
+  }
+  return "";
+}
+
+std::string scanner_phone(const std::string &text) {
+  size_t pos = 0, len = 0;
+  if (muzloto::extract::find_phone(text, pos, len)) {
+    return text.substr(pos, len);
+  }
+  return "";
+}
+
+// Время одного вызова в наносекундах
+template <typename Fn>
+double time_per_call(const std::vector<std::string> &samples, int iterations,
+                     Fn fn) {
+  size_t checksum = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    for (const auto &sample : samples) {
+      checksum += fn(sample).size();
+    }
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  if (checksum == static_cast<size_t>(-1)) {
+    std::cout << ""; // не даём компилятору выбросить цикл
+  }
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         (static_cast<double>(iterations) * samples.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+  if (iterations <= 0) {
+    iterations = 2000;
+  }
+
+  const std::vector<std::string> ratings = {
+      "10", "9", "Оценка: 7 из 10", "0-1-2-3-4-5-6-7-8-9-10", "нет ответа",
+      "  8  ", "оценка 10!", "01"};
+  const std::vector<std::string> phones = {
+      "+7 (912) 345-67-89", "89123456789", "тел. 8-912-345-67-89",
+      "+7912 345 67 89",    "нет",         "12345",
+      "Спасибо! +7(999)123-45-67 звоните", "8 999 12 34"};
+
+  int mismatches = 0;
+  for (const auto &s : ratings) {
+    if (regex_rating(s) != muzloto::extract::find_rating(s)) {
+      std::cerr << "rating mismatch: " << s << std::endl;
+      mismatches++;
+    }
+  }
+  for (const auto &s : phones) {
+    if (regex_phone(s) != scanner_phone(s)) {
+      std::cerr << "phone mismatch: " << s << std::endl;
+      mismatches++;
+    }
+  }
+
+  double rating_regex_ns = time_per_call(ratings, iterations, regex_rating);
+  double rating_scan_ns = time_per_call(ratings, iterations, [](auto &s) {
+    return muzloto::extract::find_rating(s);
+  });
+  double phone_regex_ns = time_per_call(phones, iterations, regex_phone);
+  double phone_scan_ns = time_per_call(phones, iterations, scanner_phone);
+
+  std::cout << "{\"iterations\": " << iterations
+            << ", \"rating_regex_ns\": " << rating_regex_ns
+            << ", \"rating_scanner_ns\": " << rating_scan_ns
+            << ", \"phone_regex_ns\": " << phone_regex_ns
+            << ", \"phone_scanner_ns\": " << phone_scan_ns
+            << ", \"mismatches\": " << mismatches << "}" << std::endl;
+
+  return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,430 @@
+// Бенчмарк конвейера сканирования через C-интерфейс muzloto_core.
+//
+// Прогоняет корпус изображений (по умолчанию photos/) N раз через
+// загрузку -> выравнивание -> предобработку -> OCR -> разбор -> JSON и
+// печатает JSON с p50/p95/p99 каждого этапа, пропускной способностью пула
+// на 1..N потоках и пиковым RSS процесса. Отдельно сравнивает
+// предобработку профиля Fast: цепочку OpenCV и FusedBinarizer.
+//
+//   muzloto_bench [--corpus DIR] [--repeat N] [--threads N]
+//                 [--tessdata DIR] [--profile quality|fast]
+//                 [--backend cpu|opencl|cuda|auto]
+//                 [--schema FILE] [--template FILE] [--align]
+//                 [--output FILE]
+//                 [--pipeline DECODE,PREPROCESS,OCR]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include <opencv2/opencv.hpp>
+
+#include "fused_binarizer.h"
+#include "muzloto_api.h"
+
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+namespace {
+
+struct BenchOptions {
+  std::string corpus = "photos";
+  int repeat = 3;
+  int max_threads = 0;
+  std::string tessdata;
+  std::string profile = "quality";
+  std::string backend = "cpu";
+  std::string schema_path;
+  std::string template_path;
+  bool align = false;
+  std::string output;
+  // Потоки конвейера decode/preprocess/OCR; пусто — конвейер не меряется
+  std::vector<int> pipeline;
+};
+
+using Clock = std::chrono::high_resolution_clock;
+
+double elapsed_ms(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Перцентиль по методу ближайшего ранга
+double percentile(std::vector<double> values, double p) {
+  if (values.empty()) {
+    return 0.0;
+  }
+  std::sort(values.begin(), values.end());
+  size_t rank = static_cast<size_t>(p / 100.0 * values.size() + 0.5);
+  rank = std::min(std::max<size_t>(rank, 1), values.size());
+  return values[rank - 1];
+}
+
+json summarize(const std::vector<double> &values) {
+  double sum = 0;
+  for (double v : values) {
+    sum += v;
+  }
+  return {{"count", values.size()},
+          {"mean", values.empty() ? 0.0 : sum / values.size()},
+          {"p50", percentile(values, 50)},
+          {"p95", percentile(values, 95)},
+          {"p99", percentile(values, 99)}};
+}
+
+double peak_rss_mb() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+  }
+  return 0.0;
+#else
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / (1024.0 * 1024.0); // байты
+#else
+  return usage.ru_maxrss / 1024.0; // килобайты
+#endif
+#endif
+}
+
+std::vector<std::string> collect_images(const std::string &corpus) {
+  static const std::vector<std::string> extensions = {".jpg", ".jpeg", ".png",
+                                                      ".tif", ".tiff", ".bmp"};
+  std::vector<std::string> images;
+  for (const auto &entry : fs::directory_iterator(corpus)) {
+    if (!entry.is_regular_file()) {
+      continue;
+    }
+    std::string ext = entry.path().extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    if (std::find(extensions.begin(), extensions.end(), ext) !=
+        extensions.end()) {
+      images.push_back(entry.path().string());
+    }
+  }
+  std::sort(images.begin(), images.end());
+  return images;
+}
+
+bool parse_args(int argc, char **argv, BenchOptions &options) {
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto next = [&](std::string &value) {
+      if (i + 1 >= argc) {
+        std::cerr << "Нет значения для " << arg << std::endl;
+        return false;
+      }
+      value = argv[++i];
+      return true;
+    };
+
+    std::string value;
+    if (arg == "--corpus") {
+      if (!next(options.corpus))
+        return false;
+    } else if (arg == "--repeat") {
+      if (!next(value))
+        return false;
+      options.repeat = std::max(1, std::atoi(value.c_str()));
+    } else if (arg == "--threads") {
+      if (!next(value))
+        return false;
+      options.max_threads = std::atoi(value.c_str());
+    } else if (arg == "--tessdata") {
+      if (!next(options.tessdata))
+        return false;
+    } else if (arg == "--profile") {
+      if (!next(options.profile))
+        return false;
+    } else if (arg == "--backend") {
+      if (!next(options.backend))
+        return false;
+    } else if (arg == "--schema") {
+      if (!next(options.schema_path))
+        return false;
+    } else if (arg == "--template") {
+      if (!next(options.template_path))
+        return false;
+    } else if (arg == "--align") {
+      options.align = true;
+    } else if (arg == "--output") {
+      if (!next(options.output))
+        return false;
+    } else if (arg == "--pipeline") {
+      if (!next(value))
+        return false;
+      options.pipeline.clear();
+      size_t pos = 0;
+      while (pos <= value.size()) {
+        size_t comma = std::min(value.find(',', pos), value.size());
+        options.pipeline.push_back(
+            std::atoi(value.substr(pos, comma - pos).c_str()));
+        pos = comma + 1;
+      }
+      if (options.pipeline.size() != 3) {
+        std::cerr << "--pipeline ожидает DECODE,PREPROCESS,OCR" << std::endl;
+        return false;
+      }
+    } else {
+      std::cerr << "Неизвестный аргумент: " << arg << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Этапы отчёта и ключи timings, из которых они складываются
+const std::vector<std::pair<std::string, std::vector<std::string>>> stages = {
+    {"load", {"imread", "imdecode", "wrap_pixels"}},
+    {"align", {"align"}},
+    {"preprocess",
+     {"preprocess_gray", "preprocess_denoise", "preprocess_equalize",
+      "preprocess_threshold"}},
+    {"normalize_resolution", {"normalize_resolution"}},
+    {"set_image", {"set_image"}},
+    {"recognize", {"recognize"}},
+    {"parse", {"parse"}},
+    {"serialize", {"serialize"}}};
+
+// Предобработка профиля Fast на одном потоке: прежняя цепочка OpenCV
+// (cvtColor -> medianBlur -> equalizeHist -> adaptiveThreshold) против
+// FusedBinarizer. agreement — доля совпавших пикселей бинаризации.
+json bench_preprocess_kernels(const std::vector<std::string> &images,
+                              int repeat) {
+  const int threads = cv::getNumThreads();
+  cv::setNumThreads(1); // сравнение на ядро: пул сканеров занимает все
+
+  std::vector<double> chain_ms;
+  std::vector<double> fused_ms;
+  double agreement = 0;
+  size_t compared = 0;
+  cv::Mat gray, denoised, equalized, chain_binary, fused_binary;
+  muzloto::FusedBinarizer fused;
+
+  for (const auto &path : images) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+    if (image.empty()) {
+      continue;
+    }
+    for (int r = 0; r < repeat; r++) {
+      auto start = Clock::now();
+      cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+      cv::medianBlur(gray, denoised, 3);
+      cv::equalizeHist(denoised, equalized);
+      cv::adaptiveThreshold(equalized, chain_binary, 255,
+                            cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY,
+                            11, 2);
+      chain_ms.push_back(elapsed_ms(start, Clock::now()));
+
+      start = Clock::now();
+      fused.to_gray(image);
+      fused.threshold(fused_binary);
+      fused_ms.push_back(elapsed_ms(start, Clock::now()));
+    }
+    cv::Mat same;
+    cv::compare(chain_binary, fused_binary, same, cv::CMP_EQ);
+    agreement += static_cast<double>(cv::countNonZero(same)) / same.total();
+    compared++;
+  }
+  cv::setNumThreads(threads);
+
+  double chain_p50 = percentile(chain_ms, 50);
+  double fused_p50 = percentile(fused_ms, 50);
+  return {{"opencv_chain_ms", summarize(chain_ms)},
+          {"fused_ms", summarize(fused_ms)},
+          {"speedup_p50", fused_p50 > 0 ? chain_p50 / fused_p50 : 0.0},
+          {"agreement", compared > 0 ? agreement / compared : 0.0}};
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  BenchOptions options;
+  if (!parse_args(argc, argv, options)) {
+    return 2;
+  }
+  if (options.max_threads <= 0) {
+    options.max_threads =
+        static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  }
+
+  std::vector<std::string> images;
+  try {
+    images = collect_images(options.corpus);
+  } catch (const std::exception &e) {
+    std::cerr << "Не удалось прочитать корпус: " << e.what() << std::endl;
+    return 2;
+  }
+  if (images.empty()) {
+    std::cerr << "В корпусе нет изображений: " << options.corpus << std::endl;
+    return 2;
+  }
+
+  void *scanner = muzloto_create();
+  if (!muzloto_initialize(scanner, options.tessdata.empty()
+                                       ? nullptr
+                                       : options.tessdata.c_str())) {
+    std::cerr << "Не удалось инициализировать сканер" << std::endl;
+    muzloto_destroy(scanner);
+    return 1;
+  }
+  if (!muzloto_set_preprocess_profile(scanner, options.profile.c_str()) ||
+      !muzloto_set_preprocess_backend(scanner, options.backend.c_str()) ||
+      (!options.schema_path.empty() &&
+       !muzloto_load_schema(scanner, options.schema_path.c_str())) ||
+      (!options.template_path.empty() &&
+       !muzloto_load_template(scanner, options.template_path.c_str()))) {
+    std::cerr << "Неверные настройки сканера" << std::endl;
+    muzloto_destroy(scanner);
+    return 1;
+  }
+  muzloto_set_alignment(scanner, options.align ? 1 : 0, 0, 0);
+
+  // 1. Последовательный прогон: латентность этапов одного движка
+  std::map<std::string, std::vector<double>> samples;
+  size_t failures = 0;
+  for (int r = 0; r < options.repeat; r++) {
+    for (const auto &image : images) {
+      auto start = Clock::now();
+      const char *json_str = muzloto_scan_image(scanner, image.c_str());
+      json result = json::parse(json_str);
+      muzloto_free_string(json_str);
+      double total = elapsed_ms(start, Clock::now());
+
+      if (!result.value("success", false)) {
+        failures++;
+      }
+
+      const json &timings = result.value("timings", json::object());
+      for (const auto &[stage, keys] : stages) {
+        double sum = 0;
+        bool present = false;
+        for (const auto &key : keys) {
+          if (timings.contains(key)) {
+            sum += timings[key].get<double>();
+            present = true;
+          }
+        }
+        if (present) {
+          samples[stage].push_back(sum);
+        }
+      }
+
+      // Всё, что не вошло в processing_time_ms: сериализация, копирование
+      // строки и разбор JSON на стороне вызывающего
+      double processing = result.value("processing_time_ms", 0.0);
+      samples["json_roundtrip"].push_back(std::max(0.0, total - processing));
+      samples["total"].push_back(total);
+    }
+  }
+
+  json report;
+  report["corpus"] = options.corpus;
+  report["images"] = images.size();
+  report["repeat"] = options.repeat;
+  report["profile"] = options.profile;
+  // Выбранное устройство: запрошенный ускоритель может быть недоступен
+  report["backend"] = muzloto_preprocess_backend(scanner);
+  report["schema"] = options.schema_path;
+  report["template"] = options.template_path;
+  report["align"] = options.align;
+  report["failures"] = failures;
+
+  json stage_report = json::object();
+  for (const auto &[stage, values] : samples) {
+    stage_report[stage] = summarize(values);
+  }
+  report["stages_ms"] = stage_report;
+
+  // 2. Пропускная способность пула на 1, 2, 4... max_threads потоках
+  std::vector<const char *> batch;
+  for (int r = 0; r < options.repeat; r++) {
+    for (const auto &image : images) {
+      batch.push_back(image.c_str());
+    }
+  }
+
+  std::vector<int> thread_counts;
+  for (int n = 1; n < options.max_threads; n *= 2) {
+    thread_counts.push_back(n);
+  }
+  thread_counts.push_back(options.max_threads);
+
+  json throughput = json::array();
+  for (int n : thread_counts) {
+    void *pool = muzloto_pool_create(scanner, n);
+    if (!pool) {
+      std::cerr << "Не удалось создать пул на " << n << " потоков"
+                << std::endl;
+      continue;
+    }
+
+    auto start = Clock::now();
+    const char *json_str =
+        muzloto_scan_batch(pool, batch.data(), static_cast<int>(batch.size()));
+    double wall = elapsed_ms(start, Clock::now());
+    muzloto_free_string(json_str);
+    muzloto_pool_destroy(pool);
+
+    throughput.push_back({{"threads", n},
+                          {"wall_ms", wall},
+                          {"images_per_sec", batch.size() * 1000.0 / wall}});
+  }
+  report["throughput"] = throughput;
+
+  // 3. Конвейер с отдельными пулами на каждый этап
+  if (!options.pipeline.empty()) {
+    void *pipeline =
+        muzloto_pipeline_create(scanner, options.pipeline[0],
+                                options.pipeline[1], options.pipeline[2]);
+    if (pipeline) {
+      auto start = Clock::now();
+      const char *json_str = muzloto_pipeline_scan_batch(
+          pipeline, batch.data(), static_cast<int>(batch.size()));
+      double wall = elapsed_ms(start, Clock::now());
+      muzloto_free_string(json_str);
+      muzloto_pipeline_destroy(pipeline);
+
+      report["pipeline"] = {{"decode_workers", options.pipeline[0]},
+                            {"preprocess_workers", options.pipeline[1]},
+                            {"ocr_workers", options.pipeline[2]},
+                            {"wall_ms", wall},
+                            {"images_per_sec", batch.size() * 1000.0 / wall}};
+    } else {
+      std::cerr << "Не удалось создать конвейер" << std::endl;
+    }
+  }
+
+  // 4. Ядро предобработки профиля Fast отдельно от OCR
+  report["preprocess_kernels"] =
+      bench_preprocess_kernels(images, options.repeat);
+  report["peak_rss_mb"] = peak_rss_mb();
+
+  muzloto_destroy(scanner);
+
+  if (options.output.empty()) {
+    std::cout << report.dump(2) << std::endl;
+  } else {
+    std::ofstream out(options.output);
+    out << report.dump(2) << std::endl;
+  }
+  return 0;
+}
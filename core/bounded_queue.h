@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+namespace muzloto {
+
+// Очередь с ограниченной ёмкостью для передачи работы между потоками.
+// push() блокирует, пока очередь полна, — так производитель не убегает
+// вперёд потребителя. После close() новые элементы не принимаются, а
+// pop() возвращает false, как только очередь опустеет.
+template <typename T> class BoundedQueue {
+public:
+  static constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+
+  explicit BoundedQueue(size_t capacity = unbounded)
+      : capacity(capacity > 0 ? capacity : 1) {}
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  // false, если очередь закрыта
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+    if (closed) {
+      return false;
+    }
+    items.push_back(std::move(item));
+    lock.unlock();
+    not_empty.notify_one();
+    return true;
+  }
+
+  // false, если очередь закрыта и пуста
+  bool pop(T &item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_empty.wait(lock, [this] { return closed || !items.empty(); });
+    return take(lock, item);
+  }
+
+  // false, если за timeout элемент так и не появился
+  template <typename Rep, typename Period>
+  bool pop_for(T &item, std::chrono::duration<Rep, Period> timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    not_empty.wait_for(lock, timeout,
+                       [this] { return closed || !items.empty(); });
+    return take(lock, item);
+  }
+
+  bool try_pop(T &item) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return take(lock, item);
+  }
+
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      closed = true;
+    }
+    not_full.notify_all();
+    not_empty.notify_all();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return items.size();
+  }
+
+private:
+  bool take(std::unique_lock<std::mutex> &lock, T &item) {
+    if (items.empty()) {
+      return false;
+    }
+    item = std::move(items.front());
+    items.pop_front();
+    lock.unlock();
+    not_full.notify_one();
+    return true;
+  }
+
+  const size_t capacity;
+  std::deque<T> items;
+  bool closed = false;
+  mutable std::mutex mutex;
+  std::condition_variable not_full;
+  std::condition_variable not_empty;
+};
+
+} // namespace muzloto
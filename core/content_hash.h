@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace muzloto {
+
+// Быстрый некриптографический хеш содержимого файлов (XXH64, совместим с
+// эталонной реализацией xxHash). Нужен, чтобы узнавать уже
+// отсканированные изображения независимо от имени файла.
+namespace hash {
+
+namespace detail {
+
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+// Чтение little-endian независимо от выравнивания
+inline uint64_t read64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+inline uint32_t read32(const uint8_t *p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input) {
+  acc += input * prime2;
+  acc = rotl(acc, 31);
+  return acc * prime1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t value) {
+  acc ^= round(0, value);
+  return acc * prime1 + prime4;
+}
+
+} // namespace detail
+
+inline uint64_t xxh64(const void *data, size_t size, uint64_t seed = 0) {
+  using namespace detail;
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  const uint8_t *end = p + size;
+  uint64_t h;
+
+  if (size >= 32) {
+    uint64_t v1 = seed + prime1 + prime2;
+    uint64_t v2 = seed + prime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - prime1;
+    const uint8_t *limit = end - 32;
+    do {
+      v1 = round(v1, read64(p));
+      v2 = round(v2, read64(p + 8));
+      v3 = round(v3, read64(p + 16));
+      v4 = round(v4, read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = merge(h, v1);
+    h = merge(h, v2);
+    h = merge(h, v3);
+    h = merge(h, v4);
+  } else {
+    h = seed + prime5;
+  }
+
+  h += static_cast<uint64_t>(size);
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= round(0, read64(p));
+    h = rotl(h, 27) * prime1 + prime4;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(read32(p)) * prime1;
+    h = rotl(h, 23) * prime2 + prime3;
+    p += 4;
+  }
+  for (; p < end; p++) {
+    h ^= (*p) * prime5;
+    h = rotl(h, 11) * prime1;
+  }
+
+  h ^= h >> 33;
+  h *= prime2;
+  h ^= h >> 29;
+  h *= prime3;
+  h ^= h >> 32;
+  return h;
+}
+
+inline uint64_t xxh64(const std::string &str, uint64_t seed = 0) {
+  return xxh64(str.data(), str.size(), seed);
+}
+
+// Хеш пары значений — например, содержимого и настроек сканера
+inline uint64_t combine(uint64_t a, uint64_t b) {
+  uint8_t bytes[16];
+  for (int i = 0; i < 8; i++) {
+    bytes[i] = static_cast<uint8_t>(a >> (8 * i));
+    bytes[8 + i] = static_cast<uint8_t>(b >> (8 * i));
+  }
+  return xxh64(bytes, sizeof(bytes));
+}
+
+// Читает файл целиком в buffer (ёмкость переиспользуется)
+inline bool read_file(const std::string &path, std::vector<uint8_t> &buffer) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return false;
+  }
+  buffer.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  return static_cast<bool>(
+      file.read(reinterpret_cast<char *>(buffer.data()), buffer.size()));
+}
+
+inline std::string to_hex(uint64_t value) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex(16, '0');
+  for (int i = 15; i >= 0; i--) {
+    hex[i] = digits[value & 0xF];
+    value >>= 4;
+  }
+  return hex;
+}
+
+} // namespace hash
+
+} // namespace muzloto
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define MUZLOTO_INOTIFY 1
+#endif
+
+namespace muzloto {
+
+// Новые изображения в папке по мере появления: Linux — inotify
+// (IN_CLOSE_WRITE и IN_MOVED_TO), Windows — ReadDirectoryChangesW, прочие
+// системы — опрос каталога. Событие ещё не значит, что файл дописан: на
+// Windows и при опросе оно приходит во время записи, а сканер или утилита
+// копирования может открывать и закрывать файл несколько раз. Поэтому на
+// всех системах файл выдаётся, только когда его размер и время изменения
+// не менялись settle_ms.
+//
+// Переполнение очереди событий приводит к перечитыванию всего каталога:
+// повторы отсекает журнал загрузки (IngestJournal). Пути — UTF-8.
+class FolderWatcher {
+public:
+  static constexpr int settle_ms = 500;
+  // Период опроса каталога без уведомлений системы
+  static constexpr int poll_ms = 1000;
+
+  explicit FolderWatcher(const std::string &directory)
+      : directory(std::filesystem::u8path(directory)) {
+    std::error_code ec;
+    if (!std::filesystem::is_directory(this->directory, ec)) {
+      return;
+    }
+#ifdef _WIN32
+    handle = CreateFileW(this->directory.wstring().c_str(),
+                         FILE_LIST_DIRECTORY,
+                         FILE_SHARE_READ | FILE_SHARE_WRITE |
+                             FILE_SHARE_DELETE,
+                         nullptr, OPEN_EXISTING,
+                         FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+                         nullptr);
+    overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    open = handle != INVALID_HANDLE_VALUE && overlapped.hEvent && arm();
+#elif defined(MUZLOTO_INOTIFY)
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    open = fd >= 0 && inotify_add_watch(fd, this->directory.c_str(),
+                                        IN_CLOSE_WRITE | IN_MOVED_TO) >= 0;
+#else
+    for (const auto &path : list()) {
+      known[path] = file_state(path);
+    }
+    open = true;
+#endif
+  }
+
+  ~FolderWatcher() {
+#ifdef _WIN32
+    if (handle != INVALID_HANDLE_VALUE) {
+      CancelIo(handle);
+      CloseHandle(handle);
+    }
+    if (overlapped.hEvent) {
+      CloseHandle(overlapped.hEvent);
+    }
+#elif defined(MUZLOTO_INOTIFY)
+    if (fd >= 0) {
+      ::close(fd);
+    }
+#endif
+  }
+
+  FolderWatcher(const FolderWatcher &) = delete;
+  FolderWatcher &operator=(const FolderWatcher &) = delete;
+
+  bool is_open() const { return open; }
+
+  // Размер и время изменения файла; size < 0 — файла нет
+  struct FileState {
+    int64_t size = -1;
+    int64_t mtime = 0;
+    bool operator==(const FileState &other) const {
+      return size == other.size && mtime == other.mtime;
+    }
+  };
+
+  static FileState file_state(const std::string &path) {
+    FileState state;
+    std::error_code ec;
+    const auto fs_path = std::filesystem::u8path(path);
+    const auto size = std::filesystem::file_size(fs_path, ec);
+    if (ec) {
+      return state;
+    }
+    const auto mtime = std::filesystem::last_write_time(fs_path, ec);
+    if (ec) {
+      return state;
+    }
+    state.size = static_cast<int64_t>(size);
+    state.mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+    return state;
+  }
+
+  static bool is_image(const std::filesystem::path &path) {
+    std::string ext = path.extension().u8string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    for (const char *known_ext :
+         {".jpg", ".jpeg", ".png", ".tif", ".tiff", ".bmp"}) {
+      if (ext == known_ext) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Изображения, которые уже лежат в папке, по имени
+  std::vector<std::string> list() const {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto &entry :
+         std::filesystem::directory_iterator(directory, ec)) {
+      std::error_code type_ec;
+      if (entry.is_regular_file(type_ec) && is_image(entry.path())) {
+        paths.push_back(entry.path().u8string());
+      }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+  }
+
+  // Файлы с событием, которые ещё ждут settle_ms
+  size_t settling() const { return pending.size(); }
+
+  // Ждёт новые файлы до timeout_ms (< 0 — без ограничения) и дописывает
+  // их в paths; возвращается раньше, как только они появились. false —
+  // наблюдение прервалось.
+  bool wait(std::vector<std::string> &paths, int timeout_ms) {
+    using Clock = std::chrono::steady_clock;
+    const auto deadline = Clock::now() + std::chrono::milliseconds(
+                                             std::max(0, timeout_ms));
+    while (true) {
+      int slice = pending.empty() ? poll_ms : settle_ms;
+      if (timeout_ms >= 0) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - Clock::now())
+                        .count();
+        slice = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(
+                                                          slice, left)));
+      }
+      if (!collect_changes(slice)) {
+        return false;
+      }
+      const size_t before = paths.size();
+      take_settled(paths);
+      if (paths.size() > before ||
+          (timeout_ms >= 0 && Clock::now() >= deadline)) {
+        return true;
+      }
+    }
+  }
+
+private:
+  std::filesystem::path directory;
+  bool open = false;
+
+  // Файлы с событием, ещё не выданные: состояние при последней проверке
+  // и с какого момента оно не меняется
+  struct Pending {
+    FileState state;
+    std::chrono::steady_clock::time_point since;
+  };
+  std::map<std::string, Pending> pending;
+
+  void track(const std::string &path) {
+    if (is_image(std::filesystem::u8path(path))) {
+      pending[path] = {file_state(path), std::chrono::steady_clock::now()};
+    }
+  }
+
+  // Файлы, состояние которых не менялось settle_ms, — в paths
+  void take_settled(std::vector<std::string> &paths) {
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = pending.begin(); it != pending.end();) {
+      FileState state = file_state(it->first);
+      if (state.size < 0) {
+        it = pending.erase(it); // файл удалили или переименовали
+        continue;
+      }
+      if (!(state == it->second.state)) {
+        it->second = {state, now};
+      } else if (now - it->second.since >=
+                 std::chrono::milliseconds(settle_ms)) {
+        paths.push_back(it->first);
+        it = pending.erase(it);
+        continue;
+      }
+      ++it;
+    }
+  }
+
+#ifdef MUZLOTO_INOTIFY
+  int fd = -1;
+
+  // События за timeout_ms — в pending
+  bool collect_changes(int timeout_ms) {
+    pollfd request{fd, POLLIN, 0};
+    int ready = ::poll(&request, 1, timeout_ms);
+    if (ready <= 0) {
+      return ready == 0 || errno == EINTR;
+    }
+
+    alignas(inotify_event) char buffer[1 << 16];
+    ssize_t length;
+    while ((length = ::read(fd, buffer, sizeof(buffer))) > 0) {
+      for (char *p = buffer; p < buffer + length;) {
+        const auto *event = reinterpret_cast<const inotify_event *>(p);
+        if (event->mask & IN_Q_OVERFLOW) {
+          for (const auto &path : list()) {
+            track(path);
+          }
+        } else if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+          // Повторное закрытие файла снова откладывает его на settle_ms
+          track((directory / event->name).u8string());
+        }
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+    return true;
+  }
+#elif defined(_WIN32)
+  HANDLE handle = INVALID_HANDLE_VALUE;
+  OVERLAPPED overlapped{};
+  alignas(DWORD) char notify_buffer[1 << 16];
+
+  bool arm() {
+    return ReadDirectoryChangesW(handle, notify_buffer, sizeof(notify_buffer),
+                                 FALSE,
+                                 FILE_NOTIFY_CHANGE_FILE_NAME |
+                                     FILE_NOTIFY_CHANGE_SIZE |
+                                     FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                 nullptr, &overlapped, nullptr) != 0;
+  }
+
+  // Уведомления за timeout_ms — в pending
+  bool collect_changes(int timeout_ms) {
+    DWORD waited = WaitForSingleObject(overlapped.hEvent, timeout_ms);
+    if (waited == WAIT_TIMEOUT) {
+      return true;
+    }
+    DWORD bytes = 0;
+    if (waited != WAIT_OBJECT_0 ||
+        !GetOverlappedResult(handle, &overlapped, &bytes, FALSE)) {
+      return false;
+    }
+
+    if (bytes == 0) {
+      // Буфер уведомлений переполнился
+      for (const auto &path : list()) {
+        track(path);
+      }
+    } else {
+      for (DWORD offset = 0;;) {
+        const auto *info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(
+            notify_buffer + offset);
+        if (info->Action == FILE_ACTION_ADDED ||
+            info->Action == FILE_ACTION_MODIFIED ||
+            info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+          std::wstring name(info->FileName,
+                            info->FileNameLength / sizeof(WCHAR));
+          track((directory / name).u8string());
+        }
+        if (info->NextEntryOffset == 0) {
+          break;
+        }
+        offset += info->NextEntryOffset;
+      }
+    }
+    return arm();
+  }
+#else
+  // Состояние файлов при прошлом опросе
+  std::map<std::string, FileState> known;
+
+  bool collect_changes(int timeout_ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+    std::map<std::string, FileState> current;
+    for (const auto &path : list()) {
+      FileState state = file_state(path);
+      auto it = known.find(path);
+      if (it == known.end() || !(it->second == state)) {
+        if (!pending.count(path)) {
+          track(path);
+        }
+      }
+      current[path] = state;
+    }
+    known = std::move(current);
+    return true;
+  }
+#endif
+};
+
+} // namespace muzloto
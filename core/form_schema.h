@@ -0,0 +1,303 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "form_template.h"
+#include "question_matcher.h"
+
+namespace muzloto {
+
+// Смысл ответа: определяет нормализацию и проверку значения
+enum class AnswerKind {
+  Text,   // свободный текст, как распознан
+  Rating, // оценка 1–10
+  YesNo,  // "Да" / "Нет"
+  Phone,  // телефон, приводится к +7XXXXXXXXXX
+  Choice  // один из вариантов options по ключевым словам
+};
+
+// Вариант ответа Choice: value — значение в результате, keywords —
+// подстроки распознанного ответа, по которым он выбирается
+struct AnswerOption {
+  std::string value;
+  std::vector<std::string> keywords;
+};
+
+struct SchemaField {
+  std::string id;
+  std::string question; // точный текст вопроса на бланке
+  AnswerKind kind = AnswerKind::Text;
+  std::vector<AnswerOption> options; // для Choice
+};
+
+// Схема анкеты: вопросы, ключи полей результата и типы ответов. Версии
+// бланка в разных городах отличаются набором и формулировками вопросов,
+// поэтому схема загружается из JSON и компилируется один раз: автомат
+// QuestionMatcher по вопросам и таблица полей, индекс в которой (slot) —
+// индекс ответа в ScanResult. Во время скана поля адресуются только
+// индексами, без поиска по строкам.
+//
+// Схема неизменяема и общая для всех сканеров пула.
+//
+// Формат файла:
+//   {
+//     "name": "muzloto_v1",
+//     "page": {"width": 1240, "height": 1860},
+//     "fields": [
+//       {"id": "date", "question": "Дата:", "type": "text"},
+//       {"id": "host_rating",
+//        "question": "Понравилась ли вам работа ведущего?",
+//        "type": "rating"},
+//       {"id": "ticket_price",
+//        "question": "Оцените стоимость игры за билет", "type": "choice",
+//        "options": [{"value": "можно смело ставить дороже",
+//                     "match": ["дороже"]}, "доступно", "дорого"]},
+//       ...
+//     ]
+//   }
+//
+// Типы: text, rating, yes_no, phone, choice (вариант-строка совпадает со
+// своим ключевым словом). Поле может задать область ответа, как в
+// FormTemplate: "roi", "psm", "marks", "mark_edges"; тип распознавания
+// области — "ocr" (по умолчанию из типа ответа: rating — digits, phone —
+// phone, yes_no — checkbox, иначе text). Поля с областями образуют шаблон
+// схемы, см. layout().
+class FormSchema {
+public:
+  static constexpr const char *builtin_name = "muzloto_v1";
+
+  const std::string &name() const { return schema_name; }
+  const std::vector<SchemaField> &fields() const { return field_table; }
+  size_t size() const { return field_table.size(); }
+  const QuestionMatcher &matcher() const { return question_matcher; }
+
+  // Шаблон из полей с областями ответов (slot — индекс в схеме); nullptr,
+  // если областей нет
+  const std::shared_ptr<const FormTemplate> &layout() const {
+    return form_layout;
+  }
+
+  // Индекс поля по ключу или -1; для загрузки шаблонов, не для скана
+  int find(const std::string &id) const {
+    auto it = slots.find(id);
+    return it == slots.end() ? -1 : static_cast<int>(it->second);
+  }
+
+  // Полное описание схемы для отпечатка конфигурации кэша
+  const std::string &description() const { return schema_description; }
+
+  static AnswerKind parse_kind(const std::string &name) {
+    if (name == "text") {
+      return AnswerKind::Text;
+    } else if (name == "rating") {
+      return AnswerKind::Rating;
+    } else if (name == "yes_no") {
+      return AnswerKind::YesNo;
+    } else if (name == "phone") {
+      return AnswerKind::Phone;
+    } else if (name == "choice") {
+      return AnswerKind::Choice;
+    }
+    throw std::runtime_error("Неизвестный тип ответа: " + name);
+  }
+
+  static std::shared_ptr<const FormSchema> from_json(const nlohmann::json &j) {
+    std::vector<SchemaField> fields;
+    auto layout = std::make_shared<FormTemplate>();
+    layout->name = j.value("name", "");
+    layout->parse_page(j);
+
+    for (const auto &f : j.at("fields")) {
+      SchemaField field;
+      field.id = f.at("id").get<std::string>();
+      field.question = f.at("question").get<std::string>();
+      field.kind = parse_kind(f.value("type", "text"));
+      if (field.kind == AnswerKind::Choice) {
+        parse_options(f, field);
+      }
+
+      if (f.contains("roi")) {
+        TemplateField area =
+            FormTemplate::parse_field(f, "ocr", default_ocr(field.kind));
+        area.slot = fields.size();
+        layout->fields.push_back(std::move(area));
+      }
+      fields.push_back(std::move(field));
+    }
+
+    if (layout->fields.empty()) {
+      layout.reset();
+    }
+    return std::shared_ptr<const FormSchema>(new FormSchema(
+        j.value("name", ""), std::move(fields), std::move(layout)));
+  }
+
+  static std::shared_ptr<const FormSchema> load(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+      throw std::runtime_error("Не удалось открыть схему: " + path);
+    }
+
+    try {
+      return from_json(nlohmann::json::parse(file));
+    } catch (const nlohmann::json::exception &e) {
+      throw std::runtime_error("Ошибка в схеме " + path + ": " + e.what());
+    }
+  }
+
+  // Схема бланка muzloto_v1 (она же data/schemas/muzloto_v1.json);
+  // действует, пока не загружена другая
+  static const std::shared_ptr<const FormSchema> &builtin() {
+    static const std::shared_ptr<const FormSchema> schema = make_builtin();
+    return schema;
+  }
+
+private:
+  std::string schema_name;
+  std::vector<SchemaField> field_table;
+  QuestionMatcher question_matcher;
+  std::shared_ptr<const FormTemplate> form_layout;
+  std::unordered_map<std::string, size_t> slots;
+  std::string schema_description;
+
+  FormSchema(std::string name, std::vector<SchemaField> fields,
+             std::shared_ptr<const FormTemplate> layout)
+      : schema_name(std::move(name)), field_table(std::move(fields)),
+        question_matcher(questions_of(field_table)),
+        form_layout(std::move(layout)) {
+    if (field_table.empty()) {
+      throw std::runtime_error("Схема " + schema_name + " без полей");
+    }
+    schema_description = schema_name;
+    for (size_t slot = 0; slot < field_table.size(); slot++) {
+      const SchemaField &field = field_table[slot];
+      if (field.id.empty() || field.question.empty()) {
+        throw std::runtime_error("Схема " + schema_name +
+                                 ": поле без id или вопроса");
+      }
+      if (is_reserved(field.id)) {
+        throw std::runtime_error("Ключ " + field.id +
+                                 " занят в результате сканирования");
+      }
+      if (!slots.emplace(field.id, slot).second) {
+        throw std::runtime_error("Поле " + field.id + " повторяется");
+      }
+
+      schema_description.append("|").append(field.id).append("=");
+      schema_description.append(field.question).append(":");
+      schema_description += std::to_string(static_cast<int>(field.kind));
+      for (const auto &option : field.options) {
+        schema_description.append(":").append(option.value);
+        for (const auto &keyword : option.keywords) {
+          schema_description.append(",").append(keyword);
+        }
+      }
+    }
+  }
+
+  static std::vector<std::string>
+  questions_of(const std::vector<SchemaField> &fields) {
+    std::vector<std::string> questions;
+    for (const auto &field : fields) {
+      questions.push_back(field.question);
+    }
+    return questions;
+  }
+
+  // Ключи JSON-результата, которые не могут быть полями анкеты
+  static bool is_reserved(const std::string &id) {
+    for (const char *key :
+         {"success", "error_message", "error_code", "processing_time_ms",
+          "cache_hit", "source", "page", "form", "counters", "quality",
+          "alignment", "raw_text", "fields", "timings"}) {
+      if (id == key) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static FieldType default_ocr(AnswerKind kind) {
+    switch (kind) {
+    case AnswerKind::Rating:
+      return FieldType::Digits;
+    case AnswerKind::Phone:
+      return FieldType::Phone;
+    case AnswerKind::YesNo:
+      return FieldType::Checkbox;
+    default:
+      return FieldType::Text;
+    }
+  }
+
+  static void parse_options(const nlohmann::json &f, SchemaField &field) {
+    for (const auto &o : f.at("options")) {
+      AnswerOption option;
+      if (o.is_string()) {
+        option.value = o.get<std::string>();
+        option.keywords.push_back(option.value);
+      } else {
+        option.value = o.at("value").get<std::string>();
+        option.keywords = o.value("match", std::vector<std::string>());
+        if (option.keywords.empty()) {
+          option.keywords.push_back(option.value);
+        }
+      }
+      field.options.push_back(std::move(option));
+    }
+    if (field.options.empty()) {
+      throw std::runtime_error("Поле " + field.id + ": пустой список options");
+    }
+  }
+
+  static SchemaField field(std::string id, std::string question,
+                           AnswerKind kind = AnswerKind::Text,
+                           std::vector<AnswerOption> options = {}) {
+    return {std::move(id), std::move(question), kind, std::move(options)};
+  }
+
+  static std::shared_ptr<const FormSchema> make_builtin() {
+    const AnswerKind rating = AnswerKind::Rating;
+    std::vector<SchemaField> fields = {
+        field("date", "Дата:"),
+        field("table_number", "Номер столика:"),
+        field("location", "Место игры:"),
+        field("satisfaction_rating", "Довольны ли вы посещением Музлото?",
+              rating),
+        field("playlist_rating", "Понравился ли вам плейлист?", rating),
+        field("tracks_to_add", "Какие треки вы бы добавили?"),
+        field("location_rating", "Понравилась ли вам локация?", rating),
+        field("kitchen_rating", "Понравилась ли вам кухня и бар?", rating),
+        field("service_rating", "Устроил ли вас сервис, время подачи?",
+              rating),
+        field("host_rating", "Понравилась ли вам работа ведущего?", rating),
+        field("visits_count", "Сколько раз вы были на Музлото?"),
+        field("ticket_price", "Оцените стоимость игры за билет",
+              AnswerKind::Choice,
+              {{"можно смело ставить дороже", {"дороже"}},
+               {"доступно", {"доступно"}},
+               {"дорого", {"дорого"}}}),
+        field("know_booking",
+              "Знаете ли вы, что Музлото можно заказать на корпоратив или "
+              "день рождения",
+              AnswerKind::YesNo),
+        field("source_info", "Откуда вы о нас узнали?"),
+        field("purpose", "Ради чего вы обычно ходите на подобные вечеринки?"),
+        field("improvements", "Что нам стоит улучшить?"),
+        field("phone_number",
+              "Если вы хотите, чтобы мы с вами связались - оставьте ваш "
+              "номер телефона.",
+              AnswerKind::Phone)};
+    return std::shared_ptr<const FormSchema>(
+        new FormSchema(builtin_name, std::move(fields), nullptr));
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+#include <tesseract/baseapi.h>
+#include <vector>
+
+namespace muzloto {
+
+// Тип ответа определяет профиль распознавания области
+enum class FieldType {
+  Text,     // свободный текст: полная модель rus+eng
+  Digits,   // числа (оценки, номер столика)
+  Phone,    // цифры и +()-
+  Checkbox, // короткий ответ да/нет
+  Marks     // отметка в одной из ячеек (OMR, без OCR)
+};
+
+// Профиль распознавания: допустимые символы (tessedit_char_whitelist,
+// пусто — без ограничений) и движок. Латинский движок с одной моделью
+// "eng" заметно быстрее rus+eng, а для цифр его достаточно.
+struct FieldProfile {
+  const char *whitelist;
+  bool latin_engine;
+};
+
+inline FieldProfile profile_of(FieldType type) {
+  switch (type) {
+  case FieldType::Digits:
+    return {"0123456789", true};
+  case FieldType::Phone:
+    return {"0123456789+()- ", true};
+  case FieldType::Checkbox:
+    return {"ДаНетдане", false};
+  case FieldType::Text:
+  case FieldType::Marks:
+    break;
+  }
+  return {"", false};
+}
+
+// Область ответа на странице анкеты. Координаты нормированы к размеру
+// страницы (0..1), поэтому не зависят от разрешения снимка.
+struct TemplateField {
+  std::string id;
+  float x = 0, y = 0, width = 0, height = 0;
+  tesseract::PageSegMode psm = tesseract::PSM_SINGLE_LINE;
+  FieldType type = FieldType::Text;
+  // Для Marks: значения ячеек слева направо и их относительные границы
+  // внутри roi (marks.size() + 1 чисел от 0 до 1)
+  std::vector<std::string> marks;
+  std::vector<float> mark_edges;
+  size_t slot = 0; // индекс поля в схеме сканера, заполняется при загрузке
+};
+
+// Шаблон анкеты с фиксированной разметкой: вместо распознавания всей
+// страницы и поиска вопросов по тексту OCR выполняется только в областях
+// ответов.
+//
+// Формат файла:
+//   {
+//     "name": "muzloto_v1",
+//     "page": {"width": 1240, "height": 1860},
+//     "fields": [
+//       {"id": "date", "roi": [0.175, 0.109, 0.162, 0.038],
+//        "psm": "single_line", "type": "text"},
+//       {"id": "know_booking", "roi": [0.710, 0.665, 0.225, 0.048],
+//        "type": "marks", "marks": ["да", "нет"]},
+//       ...
+//
+// Ячейки marks по умолчанию равной ширины; неравные задаются границами
+// "mark_edges": [0, 0.6, 0.84, 1].
+//     ]
+//   }
+struct FormTemplate {
+  std::string name;
+  int page_width = 0;
+  int page_height = 0;
+  std::vector<TemplateField> fields;
+
+  static tesseract::PageSegMode parse_psm(const std::string &name) {
+    if (name == "single_line") {
+      return tesseract::PSM_SINGLE_LINE;
+    } else if (name == "single_block") {
+      return tesseract::PSM_SINGLE_BLOCK;
+    } else if (name == "single_word") {
+      return tesseract::PSM_SINGLE_WORD;
+    }
+    throw std::runtime_error("Неизвестный режим сегментации: " + name);
+  }
+
+  static FieldType parse_type(const std::string &name) {
+    if (name == "text") {
+      return FieldType::Text;
+    } else if (name == "digits") {
+      return FieldType::Digits;
+    } else if (name == "phone") {
+      return FieldType::Phone;
+    } else if (name == "checkbox") {
+      return FieldType::Checkbox;
+    } else if (name == "marks") {
+      return FieldType::Marks;
+    }
+    throw std::runtime_error("Неизвестный тип поля: " + name);
+  }
+
+  static void parse_marks(const nlohmann::json &f, TemplateField &field) {
+    field.marks = f.at("marks").get<std::vector<std::string>>();
+    if (field.marks.empty()) {
+      throw std::runtime_error("Поле " + field.id + ": пустой список marks");
+    }
+
+    if (f.contains("mark_edges")) {
+      field.mark_edges = f["mark_edges"].get<std::vector<float>>();
+    } else {
+      for (size_t i = 0; i <= field.marks.size(); i++) {
+        field.mark_edges.push_back(static_cast<float>(i) /
+                                   field.marks.size());
+      }
+    }
+
+    if (field.mark_edges.size() != field.marks.size() + 1 ||
+        !std::is_sorted(field.mark_edges.begin(), field.mark_edges.end()) ||
+        field.mark_edges.front() < 0 || field.mark_edges.back() > 1) {
+      throw std::runtime_error("Поле " + field.id +
+                               ": mark_edges не задают ячейки marks");
+    }
+  }
+
+  // Область ответа из описания поля; тип распознавания — по ключу
+  // type_key (в схеме анкеты "type" занят типом ответа)
+  static TemplateField parse_field(const nlohmann::json &f,
+                                   const char *type_key,
+                                   FieldType default_type) {
+    TemplateField field;
+    field.id = f.at("id").get<std::string>();
+
+    const auto &roi = f.at("roi");
+    if (!roi.is_array() || roi.size() != 4) {
+      throw std::runtime_error("Поле " + field.id +
+                               ": roi должен быть [x, y, w, h]");
+    }
+    field.x = roi[0].get<float>();
+    field.y = roi[1].get<float>();
+    field.width = roi[2].get<float>();
+    field.height = roi[3].get<float>();
+    if (field.x < 0 || field.y < 0 || field.width <= 0 || field.height <= 0 ||
+        field.x + field.width > 1.0f || field.y + field.height > 1.0f) {
+      throw std::runtime_error("Поле " + field.id +
+                               ": roi выходит за пределы страницы");
+    }
+
+    field.psm = parse_psm(f.value("psm", "single_line"));
+    field.type = f.contains(type_key)
+                     ? parse_type(f[type_key].get<std::string>())
+                     : default_type;
+    if (field.type == FieldType::Marks) {
+      parse_marks(f, field);
+    }
+    return field;
+  }
+
+  void parse_page(const nlohmann::json &j) {
+    if (j.contains("page")) {
+      page_width = j["page"].value("width", 0);
+      page_height = j["page"].value("height", 0);
+    }
+  }
+
+  static FormTemplate from_json(const nlohmann::json &j) {
+    FormTemplate form;
+    form.name = j.value("name", "");
+    form.parse_page(j);
+
+    for (const auto &f : j.at("fields")) {
+      form.fields.push_back(parse_field(f, "type", FieldType::Text));
+    }
+
+    return form;
+  }
+
+  static FormTemplate load(const std::string &path) {
+    std::ifstream file(path);
+    if (!file) {
+      throw std::runtime_error("Не удалось открыть шаблон: " + path);
+    }
+
+    try {
+      return from_json(nlohmann::json::parse(file));
+    } catch (const nlohmann::json::exception &e) {
+      throw std::runtime_error("Ошибка в шаблоне " + path + ": " + e.what());
+    }
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace muzloto {
+
+// Журнал загрузки папки: хеши содержимого файлов, строки которых уже
+// записаны в журнал результатов (ResultSink). По нему повторный запуск
+// после сбоя продолжает с того места, где остановился, а копия уже
+// загруженного снимка под другим именем не попадает в результаты дважды.
+//
+// Пакет фиксируется так:
+//   begin <строк в журнале результатов до пакета> <после пакета>
+//   <хеш> <размер> <mtime> <путь>       — файл, распознан
+//   fail <хеш> <размер> <mtime> <путь>  — файл, строка с ошибкой
+//   commit
+// Строки пакета пишутся в журнал результатов между begin и commit. Если
+// процесс упал до commit, при открытии пакет считается записанным, если в
+// журнале результатов не меньше строк, чем "после пакета". Иначе пакет
+// записан не целиком: журнал результатов укорачивается до "до пакета",
+// пакет отменяется (abort), и его файлы загружаются снова — распознанное
+// до сбоя при этом берётся из кэша результатов, без повторного OCR.
+//
+// Распознанным считается только успешный результат. Файл с ошибкой
+// (недописанный снимок, сбой OCR) загружается снова при следующей
+// встрече; повторная ошибка того же содержимого не даёт второй строки.
+class IngestJournal {
+public:
+  struct Entry {
+    uint64_t hash = 0;
+    int64_t size = 0;
+    int64_t mtime = 0;
+    std::string path;
+    bool failed = false;
+  };
+
+  // sink_rows — строк в журнале результатов сейчас; truncate_sink(rows)
+  // укорачивает его до rows строк при откате оборванного пакета (true —
+  // успешно; иначе журнал не открывается)
+  template <typename TruncateFn>
+  IngestJournal(const std::string &path, int64_t sink_rows,
+                TruncateFn truncate_sink) {
+    Recovery recovery = load(path, sink_rows);
+    if (recovery.rollback_to >= 0 && !truncate_sink(recovery.rollback_to)) {
+      return;
+    }
+    file.open(path, std::ios::binary | std::ios::app);
+    if (file) {
+      write(recovery.append);
+    }
+  }
+
+  IngestJournal(const IngestJournal &) = delete;
+  IngestJournal &operator=(const IngestJournal &) = delete;
+
+  bool is_open() const { return file.is_open() && file.good(); }
+
+  // Распознанных файлов в записанных пакетах
+  size_t size() const { return hashes.size(); }
+
+  // Содержимое уже распознано и записано
+  bool contains(uint64_t hash) const { return hashes.count(hash) > 0; }
+
+  // Для этого содержимого уже записана строка с ошибкой
+  bool failed_before(uint64_t hash) const {
+    return failed_hashes.count(hash) > 0;
+  }
+
+  // Тот же путь с тем же размером и временем изменения уже распознан —
+  // файл можно не читать ради хеша
+  bool seen(const std::string &path, int64_t size, int64_t mtime) const {
+    auto it = files.find(path);
+    return it != files.end() && it->second.size == size &&
+           it->second.mtime == mtime;
+  }
+
+  // Фиксирует пакет: begin и файлы, затем write_sink() (запись строк в
+  // журнал результатов, true — успешно), затем commit или abort.
+  // rows_before/rows_after — строк в журнале результатов до и после.
+  template <typename WriteFn>
+  bool record(const std::vector<Entry> &entries, int64_t rows_before,
+              int64_t rows_after, WriteFn write_sink) {
+    std::string batch = "begin " + std::to_string(rows_before) + " " +
+                        std::to_string(rows_after) + "\n";
+    for (const auto &entry : entries) {
+      append_entry(batch, entry);
+    }
+    if (!write(batch)) {
+      return false;
+    }
+    if (!write_sink()) {
+      write("abort\n");
+      return false;
+    }
+    if (!write("commit\n")) {
+      return false;
+    }
+    for (const auto &entry : entries) {
+      remember(entry);
+    }
+    return true;
+  }
+
+private:
+  struct FileState {
+    int64_t size = 0;
+    int64_t mtime = 0;
+  };
+
+  // Что сделать с оборванным пакетом при открытии
+  struct Recovery {
+    std::string append;       // дописать в журнал загрузки
+    int64_t rollback_to = -1; // строк оставить в журнале результатов
+  };
+
+  std::ofstream file;
+  std::unordered_set<uint64_t> hashes;
+  std::unordered_set<uint64_t> failed_hashes;
+  std::unordered_map<std::string, FileState> files;
+
+  bool write(const std::string &data) {
+    if (data.empty()) {
+      return true;
+    }
+    file.write(data.data(), data.size());
+    file.flush();
+    return file.good();
+  }
+
+  void remember(const Entry &entry) {
+    if (entry.failed) {
+      failed_hashes.insert(entry.hash);
+      return;
+    }
+    hashes.insert(entry.hash);
+    files[entry.path] = {entry.size, entry.mtime};
+  }
+
+  static void append_entry(std::string &out, const Entry &entry) {
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx",
+                  static_cast<unsigned long long>(entry.hash));
+    if (entry.failed) {
+      out.append("fail ");
+    }
+    out.append(hash).append(" ");
+    out += std::to_string(entry.size) + " " + std::to_string(entry.mtime);
+    out.append(" ").append(entry.path).append("\n");
+  }
+
+  static bool parse_entry(const std::string &line, Entry &entry) {
+    std::istringstream in(line);
+    std::string hash;
+    if (!(in >> hash)) {
+      return false;
+    }
+    entry.failed = hash == "fail";
+    if ((entry.failed && !(in >> hash)) ||
+        !(in >> entry.size >> entry.mtime) || hash.size() != 16) {
+      return false;
+    }
+    try {
+      entry.hash = std::stoull(hash, nullptr, 16);
+    } catch (const std::exception &) {
+      return false;
+    }
+    in.get(); // пробел перед путём
+    std::getline(in, entry.path);
+    return !entry.path.empty();
+  }
+
+  // Читает записанные пакеты и решает судьбу оборванного
+  Recovery load(const std::string &path, int64_t sink_rows) {
+    Recovery recovery;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      return recovery;
+    }
+
+    std::vector<Entry> batch;
+    bool open_batch = false;
+    int64_t rows_before = -1;
+    int64_t rows_after = 0;
+    bool torn = false;
+    std::string line;
+    while (std::getline(in, line)) {
+      torn = in.eof(); // последняя строка без перевода строки
+      if (line.compare(0, 6, "begin ") == 0) {
+        batch.clear();
+        open_batch = true;
+        rows_before = -1;
+        rows_after = 0;
+        std::istringstream counts(line.substr(6));
+        counts >> rows_before >> rows_after;
+      } else if (line == "commit") {
+        for (const auto &entry : batch) {
+          remember(entry);
+        }
+        batch.clear();
+        open_batch = false;
+      } else if (line == "abort") {
+        batch.clear();
+        open_batch = false;
+      } else if (open_batch) {
+        Entry entry;
+        if (parse_entry(line, entry)) {
+          batch.push_back(std::move(entry));
+        }
+      }
+    }
+
+    recovery.append = torn ? "\n" : "";
+    if (open_batch) {
+      if (sink_rows >= rows_after) {
+        for (const auto &entry : batch) {
+          remember(entry);
+        }
+        recovery.append += "commit\n";
+      } else {
+        if (rows_before >= 0 && sink_rows > rows_before) {
+          recovery.rollback_to = rows_before;
+        }
+        recovery.append += "abort\n";
+      }
+    }
+    return recovery;
+  }
+};
+
+} // namespace muzloto
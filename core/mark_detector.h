@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace muzloto {
+
+// Распознавание отметок (OMR) в известных ячейках выровненной страницы:
+// кружки оценок 0–10, варианты цены билета, да/нет. Вместо OCR считается
+// доля тёмных пикселей в каждой ячейке — отмеченная заметно темнее
+// остальных, в которых только напечатанная цифра или рамка.
+struct MarkResult {
+  int index = -1;         // отмеченная ячейка, -1 — отметки нет
+  float confidence = 0;   // насколько выбранная ячейка темнее следующей
+  std::vector<float> fill; // доля тёмных пикселей по ячейкам
+};
+
+class MarkDetector {
+public:
+  // Отметка должна быть темнее типичной ячейки хотя бы на эту долю
+  static constexpr float min_fill_delta = 0.03f;
+
+  // Пиксель темнее этого порога считается тёмным
+  static constexpr double dark_threshold = 128;
+
+  // page — страница после бинаризации (текст чёрный на белом); она может
+  // быть уменьшена под OCR с INTER_AREA, и тогда края штрихов серые, а не
+  // чёрные. roi делится на ячейки по edges — относительным границам
+  // 0 < ... < 1, включая 0 и 1
+  static MarkResult detect(const cv::Mat &page, const cv::Rect &roi,
+                           const std::vector<float> &edges) {
+    MarkResult result;
+    if (edges.size() < 2 || roi.width <= 0 || roi.height <= 0) {
+      return result;
+    }
+
+    // Края ячеек и рамку области не считаем: там контуры кружков
+    const int margin_y = roi.height / 6;
+    cv::Mat dark;
+    for (size_t i = 0; i + 1 < edges.size(); i++) {
+      int left = roi.x + static_cast<int>(edges[i] * roi.width);
+      int right = roi.x + static_cast<int>(edges[i + 1] * roi.width);
+      int margin_x = (right - left) / 6;
+      cv::Rect cell(left + margin_x, roi.y + margin_y,
+                    right - left - 2 * margin_x, roi.height - 2 * margin_y);
+      if (cell.width <= 0 || cell.height <= 0) {
+        result.fill.push_back(0);
+        continue;
+      }
+      // Порог, а не countNonZero по странице: серый пиксель уменьшенной
+      // страницы иначе считался бы белым, и лёгкая отметка терялась
+      cv::compare(page(cell), dark_threshold, dark, cv::CMP_LT);
+      result.fill.push_back(static_cast<float>(cv::countNonZero(dark)) /
+                            cell.area());
+    }
+
+    // Самая тёмная ячейка против второй и против типичной (медианы
+    // остальных)
+    std::vector<float> sorted = result.fill;
+    std::sort(sorted.begin(), sorted.end(), std::greater<float>());
+    const float best = sorted[0];
+    const float second = sorted.size() > 1 ? sorted[1] : 0.0f;
+    const float typical =
+        sorted.size() > 1 ? sorted[1 + (sorted.size() - 2) / 2] : 0.0f;
+    if (best - typical < min_fill_delta) {
+      return result;
+    }
+
+    result.index = static_cast<int>(
+        std::max_element(result.fill.begin(), result.fill.end()) -
+        result.fill.begin());
+    result.confidence = std::clamp((best - second) / best, 0.0f, 1.0f);
+    return result;
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,367 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace muzloto {
+
+// Резидентная память процесса, байты; 0 — не удалось узнать
+inline int64_t process_resident_bytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return static_cast<int64_t>(counters.WorkingSetSize);
+  }
+  return 0;
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info), &count) != KERN_SUCCESS) {
+    return 0;
+  }
+  return static_cast<int64_t>(info.resident_size);
+#else
+  std::ifstream statm("/proc/self/statm");
+  int64_t size = 0, resident = 0;
+  if (!(statm >> size >> resident)) {
+    return 0;
+  }
+  return resident * sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Загрузка рабочих потоков: сколько задач ждёт, сколько выполняется и
+// суммарное время выполнения. Утилизация за интервал —
+// прирост busy_seconds / (workers * длительность интервала).
+struct WorkerLoad {
+  std::atomic<int64_t> queued{0};
+  std::atomic<int64_t> busy{0};
+  std::atomic<uint64_t> busy_ns{0};
+};
+
+// Выполнение одной задачи, от взятия из очереди до конца
+class BusyScope {
+public:
+  explicit BusyScope(WorkerLoad &load, bool dequeued = true)
+      : load(load), start(std::chrono::steady_clock::now()) {
+    if (dequeued) {
+      load.queued--;
+    }
+    load.busy++;
+  }
+
+  ~BusyScope() {
+    load.busy_ns += static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+    load.busy--;
+  }
+
+  BusyScope(const BusyScope &) = delete;
+  BusyScope &operator=(const BusyScope &) = delete;
+
+private:
+  WorkerLoad &load;
+  std::chrono::steady_clock::time_point start;
+};
+
+// Метрики ядра на весь процесс: счётчики сканов и отказов по причинам,
+// гистограммы длительности этапов (ключи timings), кэш результатов,
+// очереди и загрузка пулов, движки Tesseract и их память. Снимок — JSON
+// или текст OpenMetrics для Prometheus.
+//
+// Память движка Tesseract напрямую не узнать, поэтому она оценивается по
+// приросту резидентной памяти процесса во время инициализации движков.
+class Metrics {
+public:
+  // Границы корзин гистограмм, миллисекунды
+  static constexpr std::array<double, 13> bucket_ms = {
+      1, 2.5, 5, 10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000};
+
+  struct PoolSample {
+    int64_t workers = 0;
+    int64_t busy = 0;
+    int64_t queued = 0;
+    double busy_seconds = 0;
+  };
+  using PoolSampler = std::function<PoolSample()>;
+
+  static Metrics &global() {
+    static Metrics metrics;
+    return metrics;
+  }
+
+  Metrics(const Metrics &) = delete;
+  Metrics &operator=(const Metrics &) = delete;
+
+  // Завершённый скан. reason — код отказа (пусто — "error"); timings —
+  // этапы скана. Результаты из кэша в гистограммы этапов не попадают.
+  void record_scan(bool success, const std::string &reason, bool cache_hit,
+                   double total_ms,
+                   const std::vector<std::pair<std::string, double>> &timings) {
+    std::lock_guard<std::mutex> lock(mutex);
+    scans++;
+    if (!success) {
+      failures[reason.empty() ? "error" : reason]++;
+    }
+    stages["total"].observe(total_ms);
+    if (!cache_hit) {
+      for (const auto &[stage, ms] : timings) {
+        stages[stage].observe(ms);
+      }
+    }
+  }
+
+  void record_cache(bool hit) { (hit ? cache_hits : cache_misses)++; }
+
+  void add_engines(int64_t count, int64_t bytes) {
+    engines += count;
+    engine_bytes += bytes;
+  }
+
+  // Пул сообщает свои очереди и загрузку, пока зарегистрирован; kind —
+  // метка pool ("scanner", "pipeline")
+  void attach_pool(const void *owner, const std::string &kind,
+                   PoolSampler sampler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pools[owner] = {kind, std::move(sampler)};
+  }
+
+  void detach_pool(const void *owner) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pools.erase(owner);
+  }
+
+  nlohmann::json snapshot_json() {
+    std::lock_guard<std::mutex> lock(mutex);
+    const int64_t hits = cache_hits;
+    const int64_t misses = cache_misses;
+
+    nlohmann::json stage_json = nlohmann::json::object();
+    for (const auto &[stage, histogram] : stages) {
+      nlohmann::json buckets = nlohmann::json::array();
+      for (size_t i = 0; i < bucket_ms.size(); i++) {
+        buckets.push_back({{"le_ms", bucket_ms[i]},
+                           {"count", histogram.cumulative(i)}});
+      }
+      stage_json[stage] = {{"count", histogram.count},
+                           {"sum_ms", histogram.sum_ms},
+                           {"buckets", buckets}};
+    }
+
+    nlohmann::json pool_json = nlohmann::json::object();
+    for (const auto &[kind, sample] : pool_samples()) {
+      pool_json[kind] = {{"workers", sample.workers},
+                         {"busy", sample.busy},
+                         {"queue_depth", sample.queued},
+                         {"busy_seconds", sample.busy_seconds}};
+    }
+
+    return {{"scans_total", scans},
+            {"failures", failures},
+            {"cache",
+             {{"hits", hits},
+              {"misses", misses},
+              {"hit_rate", hits + misses > 0
+                               ? static_cast<double>(hits) / (hits + misses)
+                               : 0.0}}},
+            {"stages", stage_json},
+            {"pools", pool_json},
+            {"engines",
+             {{"count", engines.load()},
+              {"memory_bytes", engine_bytes.load()}}},
+            {"process_resident_bytes", process_resident_bytes()}};
+  }
+
+  // Текст OpenMetrics (его же понимает Prometheus); длительности — в
+  // секундах, как принято в Prometheus
+  std::string snapshot_openmetrics() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string out;
+
+    family(out, "muzloto_scans", "counter", "Завершённые сканы");
+    out += "muzloto_scans_total " + std::to_string(scans) + "\n";
+
+    family(out, "muzloto_scan_failures", "counter",
+           "Неудачные сканы по причинам");
+    for (const auto &[reason, count] : failures) {
+      out += "muzloto_scan_failures_total{reason=\"" + escape(reason) +
+             "\"} " + std::to_string(count) + "\n";
+    }
+
+    family(out, "muzloto_cache_hits", "counter",
+           "Результаты, взятые из кэша");
+    out += "muzloto_cache_hits_total " + std::to_string(cache_hits) + "\n";
+    family(out, "muzloto_cache_misses", "counter",
+           "Промахи кэша результатов");
+    out += "muzloto_cache_misses_total " + std::to_string(cache_misses) +
+           "\n";
+
+    family(out, "muzloto_stage_duration_seconds", "histogram",
+           "Длительность этапов скана");
+    for (const auto &[stage, histogram] : stages) {
+      const std::string label = "stage=\"" + escape(stage) + "\"";
+      for (size_t i = 0; i < bucket_ms.size(); i++) {
+        out += "muzloto_stage_duration_seconds_bucket{" + label + ",le=\"" +
+               number(bucket_ms[i] / 1000.0) + "\"} " +
+               std::to_string(histogram.cumulative(i)) + "\n";
+      }
+      out += "muzloto_stage_duration_seconds_bucket{" + label +
+             ",le=\"+Inf\"} " + std::to_string(histogram.count) + "\n";
+      out += "muzloto_stage_duration_seconds_sum{" + label + "} " +
+             number(histogram.sum_ms / 1000.0) + "\n";
+      out += "muzloto_stage_duration_seconds_count{" + label + "} " +
+             std::to_string(histogram.count) + "\n";
+    }
+
+    const auto samples = pool_samples();
+    family(out, "muzloto_queue_depth", "gauge",
+           "Задания, ожидающие рабочего потока");
+    for (const auto &[kind, sample] : samples) {
+      out += "muzloto_queue_depth{pool=\"" + kind + "\"} " +
+             std::to_string(sample.queued) + "\n";
+    }
+    family(out, "muzloto_workers", "gauge", "Рабочие потоки OCR");
+    for (const auto &[kind, sample] : samples) {
+      out += "muzloto_workers{pool=\"" + kind + "\"} " +
+             std::to_string(sample.workers) + "\n";
+    }
+    family(out, "muzloto_workers_busy", "gauge", "Занятые рабочие потоки");
+    for (const auto &[kind, sample] : samples) {
+      out += "muzloto_workers_busy{pool=\"" + kind + "\"} " +
+             std::to_string(sample.busy) + "\n";
+    }
+    family(out, "muzloto_worker_busy_seconds", "counter",
+           "Суммарное время работы потоков");
+    for (const auto &[kind, sample] : samples) {
+      out += "muzloto_worker_busy_seconds_total{pool=\"" + kind + "\"} " +
+             number(sample.busy_seconds) + "\n";
+    }
+
+    family(out, "muzloto_tesseract_engines", "gauge",
+           "Инициализированные движки Tesseract");
+    out += "muzloto_tesseract_engines " + std::to_string(engines.load()) +
+           "\n";
+    family(out, "muzloto_tesseract_engine_memory_bytes", "gauge",
+           "Оценка памяти движков Tesseract");
+    out += "muzloto_tesseract_engine_memory_bytes " +
+           std::to_string(engine_bytes.load()) + "\n";
+    family(out, "muzloto_process_resident_memory_bytes", "gauge",
+           "Резидентная память процесса");
+    out += "muzloto_process_resident_memory_bytes " +
+           std::to_string(process_resident_bytes()) + "\n";
+
+    out += "# EOF\n";
+    return out;
+  }
+
+private:
+  Metrics() = default;
+
+  struct Histogram {
+    std::array<int64_t, bucket_ms.size()> buckets{};
+    int64_t count = 0;
+    double sum_ms = 0;
+
+    void observe(double ms) {
+      for (size_t i = 0; i < bucket_ms.size(); i++) {
+        if (ms <= bucket_ms[i]) {
+          buckets[i]++;
+          break;
+        }
+      }
+      count++;
+      sum_ms += ms;
+    }
+
+    // Наблюдения не длиннее bucket_ms[i]
+    int64_t cumulative(size_t i) const {
+      int64_t total = 0;
+      for (size_t k = 0; k <= i; k++) {
+        total += buckets[k];
+      }
+      return total;
+    }
+  };
+
+  struct Pool {
+    std::string kind;
+    PoolSampler sampler;
+  };
+
+  std::mutex mutex;
+  int64_t scans = 0;
+  std::map<std::string, int64_t> failures;
+  std::map<std::string, Histogram> stages;
+  std::map<const void *, Pool> pools;
+  std::atomic<int64_t> cache_hits{0};
+  std::atomic<int64_t> cache_misses{0};
+  std::atomic<int64_t> engines{0};
+  std::atomic<int64_t> engine_bytes{0};
+
+  // Сумма по пулам одного вида; вызывается под mutex
+  std::map<std::string, PoolSample> pool_samples() const {
+    std::map<std::string, PoolSample> samples;
+    for (const auto &entry : pools) {
+      const Pool &pool = entry.second;
+      PoolSample sample = pool.sampler();
+      PoolSample &total = samples[pool.kind];
+      total.workers += sample.workers;
+      total.busy += sample.busy;
+      total.queued += sample.queued;
+      total.busy_seconds += sample.busy_seconds;
+    }
+    return samples;
+  }
+
+  static void family(std::string &out, const char *name, const char *type,
+                     const char *help) {
+    out.append("# TYPE ").append(name).append(" ").append(type).append("\n");
+    out.append("# HELP ").append(name).append(" ").append(help).append("\n");
+  }
+
+  static std::string number(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.6g", value);
+    return text;
+  }
+
+  static std::string escape(const std::string &value) {
+    std::string out;
+    for (char c : value) {
+      if (c == '\n') {
+        out += "\\n";
+        continue;
+      }
+      if (c == '\\' || c == '"') {
+        out += '\\';
+      }
+      out += c;
+    }
+    return out;
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace muzloto {
+
+// Общий кэш файлов моделей Tesseract (*.traineddata) на время запуска
+// пула. Пока жив хотя бы один ModelCache::Scope, rus.traineddata и
+// eng.traineddata читаются с диска один раз, а остальные движки пула
+// получают их из памяти через FileReader в Init. Когда последний Scope
+// закрыт, буферы освобождаются: Tesseract копирует байты в свой движок,
+// и держать ещё одну копию модели после запуска незачем.
+//
+// Память под веса кэш не экономит — каждый движок разворачивает сеть
+// у себя; выигрыш только в чтении файлов при параллельном старте.
+// Используется только с Tesseract 5: в 4.x у FileReader другой тип.
+class ModelCache {
+public:
+  using Data = std::shared_ptr<const std::vector<char>>;
+
+  static ModelCache &instance() {
+    static ModelCache cache;
+    return cache;
+  }
+
+  ModelCache(const ModelCache &) = delete;
+  ModelCache &operator=(const ModelCache &) = delete;
+
+  // Кэширование на время жизни объекта (запуск пула движков)
+  class Scope {
+  public:
+    Scope() { instance().acquire(); }
+    ~Scope() { instance().release(); }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+  };
+
+  // Содержимое файла или nullptr, если его не удалось прочитать. Вне
+  // Scope файл читается с диска без кэширования. Параллельные запросы
+  // одного файла ждут единственного чтения; чтение идёт без блокировки
+  // кэша, так что разные файлы читаются одновременно.
+  Data get(const std::string &path) {
+    std::promise<Data> loader;
+    std::shared_future<Data> pending;
+    bool owner = false; // этот поток читает файл для кэша
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (scopes > 0) {
+        auto it = files.find(path);
+        if (it == files.end()) {
+          it = files.emplace(path, loader.get_future().share()).first;
+          owner = true;
+        }
+        pending = it->second;
+      }
+    }
+    if (pending.valid() && !owner) {
+      return pending.get(); // файл читает другой поток
+    }
+    Data data = read(path);
+    if (owner) {
+      loader.set_value(data);
+    }
+    return data;
+  }
+
+  // Суммарный размер закэшированных файлов, байты
+  size_t size_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t total = 0;
+    for (const auto &[_, pending] : files) {
+      if (pending.wait_for(std::chrono::seconds(0)) ==
+              std::future_status::ready &&
+          pending.get()) {
+        total += pending.get()->size();
+      }
+    }
+    return total;
+  }
+
+  // Совместим с tesseract::FileReader Tesseract 5 (в 4.x другой тип)
+  static bool read_file(const char *filename, std::vector<char> *data) {
+    auto cached = instance().get(filename);
+    if (!cached) {
+      return false;
+    }
+    data->assign(cached->begin(), cached->end());
+    return true;
+  }
+
+private:
+  ModelCache() = default;
+
+  std::unordered_map<std::string, std::shared_future<Data>> files;
+  size_t scopes = 0;
+  mutable std::mutex mutex;
+
+  void acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    scopes++;
+  }
+
+  void release() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--scopes == 0) {
+      files.clear();
+    }
+  }
+
+  static Data read(const std::string &path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+      return nullptr;
+    }
+    auto data = std::make_shared<std::vector<char>>(
+        static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(data->data(), data->size())) {
+      return nullptr;
+    }
+    return data;
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,241 @@
+#pragma once
+
+// C-интерфейс библиотеки muzloto_core. Строки с JSON, которые возвращают
+// функции сканирования, освобождаются через muzloto_free_string.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef _WIN32
+#ifdef muzloto_core_EXPORTS
+#define MUZLOTO_EXPORT __declspec(dllexport)
+#else
+#define MUZLOTO_EXPORT __declspec(dllimport)
+#endif
+#else
+#define MUZLOTO_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// === Результат без JSON ===
+// Индексы полей MuzlotoResult.fields во встроенной схеме muzloto_v1. Для
+// схемы из muzloto_load_schema порядок и число полей задаёт она; ключ поля
+// — MuzlotoField.id.
+enum {
+  MUZLOTO_FIELD_DATE,
+  MUZLOTO_FIELD_TABLE_NUMBER,
+  MUZLOTO_FIELD_LOCATION,
+  MUZLOTO_FIELD_SATISFACTION_RATING,
+  MUZLOTO_FIELD_PLAYLIST_RATING,
+  MUZLOTO_FIELD_TRACKS_TO_ADD,
+  MUZLOTO_FIELD_LOCATION_RATING,
+  MUZLOTO_FIELD_KITCHEN_RATING,
+  MUZLOTO_FIELD_SERVICE_RATING,
+  MUZLOTO_FIELD_HOST_RATING,
+  MUZLOTO_FIELD_VISITS_COUNT,
+  MUZLOTO_FIELD_TICKET_PRICE,
+  MUZLOTO_FIELD_KNOW_BOOKING,
+  MUZLOTO_FIELD_SOURCE_INFO,
+  MUZLOTO_FIELD_PURPOSE,
+  MUZLOTO_FIELD_IMPROVEMENTS,
+  MUZLOTO_FIELD_PHONE_NUMBER,
+  MUZLOTO_FIELD_COUNT
+};
+
+// Строка UTF-8 внутри блока результата; data всегда завершается нулём
+typedef struct {
+  const char *data;
+  size_t length;
+} MuzlotoString;
+
+typedef struct {
+  MuzlotoString id; // ключ поля в схеме ("date", "host_rating"...)
+  MuzlotoString value;
+  float confidence; // 0..1; 0 — поле не найдено
+} MuzlotoField;
+
+typedef struct {
+  int success;
+  int cache_hit;
+  double processing_time_ms;
+  int image_width;
+  int image_height;
+  int page; // страница многостраничного файла (muzloto_scan_documents)
+  int form; // анкета на странице, в порядке чтения
+  MuzlotoString error_message;
+  // "blank", "not_a_form", "blurry", "busy" (все движки общего
+  // дескриптора заняты) или пусто. В режиме проверки снимка "flag"
+  // причина приходит и в успешном результате.
+  MuzlotoString error_code;
+  MuzlotoString source; // путь к изображению (пустой для буферов)
+  MuzlotoString raw_text;
+  int field_count;
+  MuzlotoField *fields; // field_count полей в порядке схемы, в том же блоке
+} MuzlotoResult;
+
+// === Сканер ===
+// Дескриптор muzloto_create владеет одним движком Tesseract: вызывать его
+// одновременно из нескольких потоков нельзя.
+MUZLOTO_EXPORT void *muzloto_create();
+// Общий дескриптор для многопоточных вызывающих: muzloto_initialize
+// создаёт n_engines движков (<= 0 — по числу ядер), каждый скан берёт
+// свободный и возвращает после скана. Если все заняты, вызов ждёт; с
+// muzloto_set_lease_timeout — не дольше timeout_ms (< 0 — без
+// ограничения), затем скан завершается ошибкой с кодом "busy". Настройки
+// задаются до первого скана и действуют на все движки.
+MUZLOTO_EXPORT void *muzloto_create_pooled(int n_engines);
+MUZLOTO_EXPORT void muzloto_set_lease_timeout(void *scanner, int timeout_ms);
+MUZLOTO_EXPORT void muzloto_destroy(void *scanner);
+MUZLOTO_EXPORT int muzloto_initialize(void *scanner, const char *tessdata_path);
+
+MUZLOTO_EXPORT const char *muzloto_scan_image(void *scanner,
+                                              const char *image_path);
+MUZLOTO_EXPORT const char *muzloto_scan_buffer(void *scanner,
+                                               const uint8_t *data, size_t len);
+MUZLOTO_EXPORT const char *muzloto_scan_pixels(void *scanner,
+                                               const uint8_t *pixels, int width,
+                                               int height, int channels,
+                                               size_t stride);
+
+// Тот же скан, но результат — структура; строки лежат в том же блоке
+// памяти. Освобождается muzloto_free_result.
+MUZLOTO_EXPORT MuzlotoResult *muzloto_scan_image_result(void *scanner,
+                                                        const char *image_path);
+
+// === Настройки сканера (до создания пула) ===
+// Схема анкеты (JSON: вопросы, ключи и типы полей); NULL или "" —
+// встроенная muzloto_v1. Шаблон, загруженный muzloto_load_template,
+// сохраняется и привязывается к полям новой схемы; без него действуют
+// области из самой схемы. 0 — ошибка в схеме или полей шаблона в ней нет
+// (прежняя схема остаётся).
+MUZLOTO_EXPORT int muzloto_load_schema(void *scanner, const char *schema_path);
+// Шаблон с областями ответов; поля — ключи текущей схемы. Порядок вызова
+// относительно muzloto_load_schema не важен. NULL или "" — снова области
+// схемы (без них — распознавание всей страницы). 0 — ошибка в шаблоне.
+MUZLOTO_EXPORT int muzloto_load_template(void *scanner,
+                                         const char *template_path);
+MUZLOTO_EXPORT void muzloto_set_alignment(void *scanner, int enabled,
+                                          int page_width, int page_height);
+MUZLOTO_EXPORT int muzloto_set_preprocess_profile(void *scanner,
+                                                  const char *profile);
+MUZLOTO_EXPORT int muzloto_set_preprocess_backend(void *scanner,
+                                                  const char *backend);
+MUZLOTO_EXPORT const char *muzloto_preprocess_backend(void *scanner);
+MUZLOTO_EXPORT void muzloto_set_text_height(void *scanner, int pixels);
+MUZLOTO_EXPORT int muzloto_set_quality_gate(void *scanner, const char *mode);
+MUZLOTO_EXPORT void muzloto_set_two_pass(void *scanner, int enabled,
+                                         const char *fast_tessdata_path);
+MUZLOTO_EXPORT int muzloto_set_result_cache(void *scanner,
+                                            const char *directory,
+                                            size_t max_bytes);
+MUZLOTO_EXPORT void muzloto_clear_result_cache(void *scanner);
+
+// === Пул сканеров для пакетной обработки ===
+MUZLOTO_EXPORT void *muzloto_pool_create(void *scanner, int n_workers);
+MUZLOTO_EXPORT void muzloto_pool_destroy(void *pool);
+MUZLOTO_EXPORT const char *muzloto_scan_batch(void *pool,
+                                              const char **image_paths,
+                                              int count);
+
+// === Асинхронное сканирование через пул ===
+// muzloto_submit ставит изображение в ограниченную очередь пула и
+// возвращается сразу; если очередь полна, ждёт свободного места.
+// Результаты забираются в порядке готовности через muzloto_poll (NULL —
+// пока нет готовых) или muzloto_wait (NULL — истёк timeout_ms или ждать
+// нечего; timeout_ms < 0 — без ограничения); в *user_tag записывается
+// метка, переданная в muzloto_submit.
+MUZLOTO_EXPORT int muzloto_submit(void *pool, const char *image_path,
+                                  int64_t user_tag);
+MUZLOTO_EXPORT const char *muzloto_poll(void *pool, int64_t *user_tag);
+MUZLOTO_EXPORT const char *muzloto_wait(void *pool, int timeout_ms,
+                                        int64_t *user_tag);
+// Число отправленных, но ещё не забранных результатов
+MUZLOTO_EXPORT int muzloto_pending(void *pool);
+
+// === Конвейер decode -> preprocess -> OCR ===
+// Отдельные пулы потоков на каждый этап (<= 0: по одному потоку на
+// декодирование и предобработку, OCR — по числу ядер). Пакет возвращается
+// JSON-массивом в порядке image_paths, как у muzloto_scan_batch.
+MUZLOTO_EXPORT void *muzloto_pipeline_create(void *scanner, int decode_workers,
+                                             int preprocess_workers,
+                                             int ocr_workers);
+MUZLOTO_EXPORT void muzloto_pipeline_destroy(void *pipeline);
+MUZLOTO_EXPORT const char *muzloto_pipeline_scan_batch(void *pipeline,
+                                                       const char **image_paths,
+                                                       int count);
+
+// Пакет в виде массива из count структур в одном блоке памяти (порядок —
+// как в image_paths); освобождается одним muzloto_free_result
+MUZLOTO_EXPORT MuzlotoResult *muzloto_scan_batch_results(
+    void *pool, const char **image_paths, int count);
+
+// Многостраничные TIFF и снимки с несколькими анкетами: каждая анкета
+// каждой страницы распознаётся пулом параллельно. JSON-массив по файлам,
+// затем по страницам и анкетам; у элементов есть "source", "page" и
+// "form".
+MUZLOTO_EXPORT const char *muzloto_scan_documents(void *pool,
+                                                  const char **image_paths,
+                                                  int count);
+// То же структурами; число результатов — в *result_count
+MUZLOTO_EXPORT MuzlotoResult *muzloto_scan_documents_results(
+    void *pool, const char **image_paths, int count, int *result_count);
+
+// === Журнал результатов (CSV, только дописывание) ===
+// Открывает или создаёт журнал с колонками columns (заголовок пишется
+// только в новый файл). NULL — файл не открылся.
+MUZLOTO_EXPORT void *muzloto_sink_open(const char *path, const char **columns,
+                                       int column_count);
+// Дописывает row_count строк: cells — row_count * column_count ячеек
+// по строкам (NULL — пустая ячейка). Весь пакет уходит на диск одной
+// записью. 1 — успешно.
+MUZLOTO_EXPORT int muzloto_sink_append(void *sink, const char **cells,
+                                       int row_count);
+// Число строк с данными в журнале
+MUZLOTO_EXPORT int64_t muzloto_sink_rows(void *sink);
+MUZLOTO_EXPORT void muzloto_sink_close(void *sink);
+
+// === Загрузка папки ===
+// Распознаёт изображения папки folder и новые по мере появления пулом
+// pool пакетами по batch_size и пакетом дописывает их в журнал sink.
+// journal_path — журнал загрузки с хешами содержимого записанных файлов:
+// после перезапуска уже записанные файлы и их копии пропускаются.
+// column_keys — по ключу на колонку sink: ключ поля схемы, "@time",
+// "@file", "@path", "@hash", "@status", "@time_ms", "@raw_text" или
+// "=текст" (текст как есть). NULL — папка или журнал не открылись, или
+// column_count не совпадает с колонками sink. pool и sink должны жить
+// дольше дескриптора.
+MUZLOTO_EXPORT void *muzloto_ingest_open(void *pool, void *sink,
+                                         const char *folder,
+                                         const char *journal_path,
+                                         const char **column_keys,
+                                         int column_count, int batch_size);
+// Загружает один пакет; если загружать нечего — сначала ждёт новые файлы
+// до timeout_ms (< 0 — без ограничения). JSON: "committed" (строк
+// записано), "succeeded" (из них распознано), "failed" (файлы, которые
+// не прочитались или не распознались), "skipped" (уже загруженные и
+// копии), "cache_hits", "pending" (ждут загрузки), "retrying" (не
+// прочитались, читаются снова на следующих шагах), "settling" (новые
+// файлы, которые ещё пишутся: выдаются, когда не менялись 500 мс),
+// "watching" (false —
+// наблюдение прервалось). Файл с ошибкой распознавания загружается снова
+// при следующей встрече; строка с той же ошибкой повторно не пишется.
+// Освобождается через muzloto_free_string.
+MUZLOTO_EXPORT const char *muzloto_ingest_step(void *ingest, int timeout_ms);
+MUZLOTO_EXPORT void muzloto_ingest_close(void *ingest);
+
+// === Метрики ===
+// Снимок метрик процесса: сканы, отказы по причинам, гистограммы этапов,
+// очереди и загрузка пулов, кэш, движки Tesseract и их память.
+// format — "json" (NULL) или "openmetrics" (текст для Prometheus).
+// NULL — неизвестный формат. Освобождается через muzloto_free_string.
+MUZLOTO_EXPORT const char *muzloto_metrics_snapshot(const char *format);
+
+MUZLOTO_EXPORT void muzloto_free_string(const char *str);
+MUZLOTO_EXPORT void muzloto_free_result(MuzlotoResult *results);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,116 +1,545 @@
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <cstring>
+#include <ctime>
+#include <deque>
 #include <iostream>
 #include <leptonica/allheaders.h>
 #include <map>
 #include <memory>
 #include <nlohmann/json.hpp>
 #include <opencv2/opencv.hpp>
-#include <regex>
-#include <sstream>
 #include <stdlib.h>
 #include <string>
 #include <tesseract/baseapi.h>
+#include <tesseract/resultiterator.h>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
-using json = nlohmann::json;
+#include "bounded_queue.h"
+#include "folder_watcher.h"
+#include "form_schema.h"
+#include "form_template.h"
+#include "fused_binarizer.h"
+#include "ingest_journal.h"
+#include "mark_detector.h"
+#include "metrics.h"
+#include "model_cache.h"
+#include "muzloto_api.h"
+#include "page_alignment.h"
+#include "page_splitter.h"
+#include "preprocess_backend.h"
+#include "quality_gate.h"
+#include "question_matcher.h"
+#include "result_cache.h"
+#include "result_sink.h"
+#include "text_extract.h"
+#include "text_resolution.h"
+#include "thread_pool.h"
 
-#ifdef _WIN32
-#define MUZLOTO_EXPORT __declspec(dllexport)
-#else
-#define MUZLOTO_EXPORT __attribute__((visibility("default")))
-#endif
+using json = nlohmann::json;
 
 namespace muzloto {
 
+// Длительности этапов обработки: (имя этапа, миллисекунды)
+using StageTimings = std::vector<std::pair<std::string, double>>;
+
+// Замеряет время между последовательными вызовами lap()
+class StageTimer {
+public:
+  explicit StageTimer(StageTimings &timings)
+      : timings(timings), last(std::chrono::high_resolution_clock::now()) {}
+
+  void lap(const char *stage) {
+    auto now = std::chrono::high_resolution_clock::now();
+    timings.emplace_back(
+        stage, std::chrono::duration<double, std::milli>(now - last).count());
+    last = now;
+  }
+
+private:
+  StageTimings &timings;
+  std::chrono::high_resolution_clock::time_point last;
+};
+
+// Профиль предобработки изображения
+enum class PreprocessProfile {
+  Quality, // fastNlMeansDenoising — медленно, но лучше для шумных фото
+  Fast     // FusedBinarizer (на GPU — медианный фильтр) — для чистых сканов
+};
+
+inline bool parse_preprocess_profile(const std::string &name,
+                                     PreprocessProfile &profile) {
+  if (name == "quality") {
+    profile = PreprocessProfile::Quality;
+  } else if (name == "fast") {
+    profile = PreprocessProfile::Fast;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Настройки сканера, которые переносятся на рабочие сканеры пула
+struct ScannerOptions {
+  PreprocessProfile preprocess_profile = PreprocessProfile::Quality;
+  // Устройство предобработки; выбирается с учётом того, что доступно
+  PreprocessBackend preprocess_backend = PreprocessBackend::Cpu;
+  // Вопросы и поля анкеты; общая для всех сканеров пула
+  std::shared_ptr<const FormSchema> schema = FormSchema::builtin();
+  // Если задан, распознаются только области ответов из шаблона
+  std::shared_ptr<const FormTemplate> form_template;
+  // Выравнивание страницы перед предобработкой. Нулевой размер страницы —
+  // размер из шаблона или PageAligner::default_width/default_height
+  bool align_page = false;
+  int page_width = 0;
+  int page_height = 0;
+  // Целевая высота символа при уменьшении снимка перед OCR, пиксели;
+  // 0 — распознавать в исходном разрешении
+  int target_text_height = TextScaleEstimator::default_text_height;
+  // Дисковый кэш результатов по содержимому файла (общий для пула)
+  std::shared_ptr<ResultCache> result_cache;
+  // Проверка пригодности снимка перед предобработкой
+  QualityGateMode quality_gate = QualityGateMode::Off;
+  // Двухпроходный режим: первый проход дешёвый (профиль Fast, мельче
+  // текст, модели из fast_tessdata_path, если он задан), затем только
+  // слабые поля распознаются заново в качественном режиме на своей области
+  bool two_pass = false;
+  std::string fast_tessdata_path;
+};
+
+// Первый проход двухпроходного режима: высота символа после уменьшения
+constexpr int fast_pass_text_height = 20;
+// Поля с меньшей уверенностью уходят на второй проход
+constexpr float refine_confidence = 0.6f;
+
 struct FieldResult {
   std::string name;
   std::string value;
   float confidence;
+  int slot = -1; // индекс поля в схеме
+  // Рамка ответа на распознанной странице (после выравнивания и
+  // масштабирования); пустая, если неизвестна
+  cv::Rect box;
 };
 
 struct ScanResult {
   bool success;
   std::string error_message;
+  // Машинный код причины отказа ("blank", "not_a_form", "blurry"); пусто
+  // для прочих ошибок
+  std::string error_code;
   std::vector<FieldResult> fields;
   std::string raw_text;
   double processing_time_ms;
+  StageTimings timings;
+
+  // Выравнивание: найдена ли страница и гомография снимок -> страница
+  // (3x3 по строкам, пусто если выравнивание выключено)
+  bool page_found = false;
+  std::vector<double> homography;
+
+  // Результат взят из ResultCache, изображение не распознавалось
+  bool cache_hit = false;
+
+  // Оценка пригодности снимка (если проверка включена)
+  QualityReport quality;
+
+  // Место анкеты в исходном файле (ScannerPool::scan_documents): путь,
+  // страница многостраничного файла и номер анкеты на странице
+  std::string source;
+  int page_index = 0;
+  int form_index = 0;
+
+  // Счётчики для мониторинга: размер исходного снимка и число символов,
+  // выданных OCR
+  int image_width = 0;
+  int image_height = 0;
+  size_t ocr_chars = 0;
+  // Полей, распознанных вторым проходом двухпроходного режима
+  int refined_fields = 0;
+
+  // Нормализация разрешения: медианная высота символа, коэффициент
+  // уменьшения и переданное в Tesseract разрешение (0 — не задано)
+  double text_height = 0;
+  double ocr_scale = 1.0;
+  int source_ppi = 0;
+
+  // Поля анкеты: answers[slot] — нормализованный ответ на вопрос
+  // schema->fields()[slot]
+  std::shared_ptr<const FormSchema> schema = FormSchema::builtin();
+  std::vector<std::string> answers;
+};
 
-  // 16 полей анкеты
-  std::string date;                // 1
-  std::string table_number;        // 2
-  std::string location;            // 3
-  std::string satisfaction_rating; // 4 (1-10)
-  std::string playlist_rating;     // 5 (1-10)
-  std::string tracks_to_add;       // 6
-  std::string location_rating;     // 7 (1-10)
-  std::string kitchen_rating;      // 8 (1-10)
-  std::string service_rating;      // 9 (1-10)
-  std::string host_rating;         // 10 (1-10)
-  std::string visits_count;        // 11
-  std::string ticket_price;        // 12 (варианты)
-  std::string know_booking;        // 13 (Да/Нет)
-  std::string source_info;         // 14
-  std::string purpose;             // 15
-  std::string improvements;        // 16
-  std::string phone_number;        // телефон
+// Рабочие буферы сканера. Переиспользуются между сканами: при неизменном
+// размере изображения OpenCV пишет в уже выделенную память, а строки и
+// векторы сохраняют ёмкость. В пуле у каждого потока свой сканер, а
+// значит и свой набор буферов.
+struct WorkBuffers {
+  cv::Mat page;
+  cv::Mat reduced; // уменьшенный снимок перед выравниванием
+  cv::Mat gray;
+  cv::Mat denoised;
+  cv::Mat equalized;
+  cv::Mat binary;
+  cv::Mat scaled;
+  TextScaleEstimator text_scale;
+  QualityGate quality_gate;
+  DeviceBuffers device;  // предобработка на OpenCL/CUDA
+  FusedBinarizer fused;  // профиль Fast на CPU
+
+  std::vector<std::string> lines;
+  std::vector<float> line_confidences; // 0..1 по строкам lines
+  std::vector<cv::Rect> line_boxes;
+  std::vector<int> line_questions;
+  std::vector<std::string> answers;
+
+  std::vector<uint8_t> file_bytes; // содержимое файла для хеша кэша
 };
 
+// Сериализация результата и ответ поля (определены после сканера)
+json result_to_json(const ScanResult &result);
+inline const std::string &answer_of(const ScanResult &result, size_t slot);
+ScanResult result_from_json(const json &j,
+                            std::shared_ptr<const FormSchema> schema);
+
+// Чтение файла изображения (этап декодирования)
+inline cv::Mat load_image(const std::string &image_path) {
+  cv::Mat image = cv::imread(image_path, cv::IMREAD_COLOR);
+  if (image.empty()) {
+    throw std::runtime_error("Не удалось загрузить изображение: " +
+                             image_path);
+  }
+  return image;
+}
+
+inline PageAligner make_aligner(const ScannerOptions &options) {
+  int width = options.page_width;
+  int height = options.page_height;
+  if ((width <= 0 || height <= 0) && options.form_template &&
+      options.form_template->page_width > 0 &&
+      options.form_template->page_height > 0) {
+    width = options.form_template->page_width;
+    height = options.form_template->page_height;
+  }
+  if (width <= 0 || height <= 0) {
+    width = PageAligner::default_width;
+    height = PageAligner::default_height;
+  }
+  return PageAligner(width, height);
+}
+
+// Предобработка через T-API. Операции с UMat ставятся в очередь OpenCL,
+// поэтому этапы до бинаризации замеряют только постановку, а ожидание
+// устройства попадает в "preprocess_threshold" вместе с выгрузкой.
+inline void preprocess_image_opencl(const cv::Mat &image,
+                                    PreprocessProfile profile,
+                                    WorkBuffers &buffers,
+                                    StageTimings &timings) {
+  DeviceBuffers &device = buffers.device;
+  StageTimer timer(timings);
+
+  image.copyTo(device.source);
+  const cv::UMat *gray = &device.source;
+  if (image.channels() != 1) {
+    cv::cvtColor(device.source, device.gray,
+                 image.channels() == 4 ? cv::COLOR_BGRA2GRAY
+                                       : cv::COLOR_BGR2GRAY);
+    gray = &device.gray;
+  }
+  timer.lap("preprocess_gray");
+
+  if (profile == PreprocessProfile::Fast) {
+    cv::medianBlur(*gray, device.denoised, 3);
+  } else {
+    cv::fastNlMeansDenoising(*gray, device.denoised, 10, 7, 21);
+  }
+  timer.lap("preprocess_denoise");
+
+  cv::equalizeHist(device.denoised, device.equalized);
+  timer.lap("preprocess_equalize");
+
+  cv::adaptiveThreshold(device.equalized, device.binary, 255,
+                        cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY, 11,
+                        2);
+  device.binary.copyTo(buffers.binary);
+  timer.lap("preprocess_threshold");
+}
+
+#ifdef MUZLOTO_WITH_CUDA
+// Предобработка на CUDA. У adaptiveThreshold нет CUDA-варианта, поэтому
+// бинаризация — дешёвый проход на CPU после выгрузки.
+inline void preprocess_image_cuda(const cv::Mat &image,
+                                  PreprocessProfile profile,
+                                  WorkBuffers &buffers,
+                                  StageTimings &timings) {
+  DeviceBuffers &device = buffers.device;
+  StageTimer timer(timings);
+
+  device.gpu_source.upload(image);
+  const cv::cuda::GpuMat *gray = &device.gpu_source;
+  if (image.channels() != 1) {
+    cv::cuda::cvtColor(device.gpu_source, device.gpu_gray,
+                       image.channels() == 4 ? cv::COLOR_BGRA2GRAY
+                                             : cv::COLOR_BGR2GRAY);
+    gray = &device.gpu_gray;
+  }
+  timer.lap("preprocess_gray");
+
+  if (profile == PreprocessProfile::Fast) {
+    if (!device.median) {
+      device.median = cv::cuda::createMedianFilter(CV_8UC1, 3);
+    }
+    device.median->apply(*gray, device.gpu_denoised);
+  } else {
+    cv::cuda::fastNlMeansDenoising(*gray, device.gpu_denoised, 10, 21, 7);
+  }
+  timer.lap("preprocess_denoise");
+
+  cv::cuda::equalizeHist(device.gpu_denoised, device.gpu_equalized);
+  device.gpu_equalized.download(buffers.equalized);
+  timer.lap("preprocess_equalize");
+
+  cv::adaptiveThreshold(buffers.equalized, buffers.binary, 255,
+                        cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY, 11,
+                        2);
+  timer.lap("preprocess_threshold");
+}
+#endif
+
+// Результат — ссылка на buffers.binary, действительна до следующего скана
+// с теми же буферами. Если ускоритель отказал, скан и все следующие с
+// этими буферами идут на CPU.
+inline const cv::Mat &preprocess_image(const cv::Mat &image,
+                                       PreprocessProfile profile,
+                                       PreprocessBackend backend,
+                                       WorkBuffers &buffers,
+                                       StageTimings &timings) {
+  if (backend != PreprocessBackend::Cpu && !buffers.device.failed) {
+    const size_t laps = timings.size();
+    try {
+#ifdef MUZLOTO_WITH_CUDA
+      if (backend == PreprocessBackend::Cuda) {
+        preprocess_image_cuda(image, profile, buffers, timings);
+        return buffers.binary;
+      }
+#endif
+      preprocess_image_opencl(image, profile, buffers, timings);
+      return buffers.binary;
+    } catch (const cv::Exception &e) {
+      buffers.device.failed = true;
+      timings.resize(laps);
+      std::cerr << "Предобработка на " << backend_name(backend)
+                << " не удалась (" << e.what() << "), дальше на CPU"
+                << std::endl;
+    }
+  }
+
+  StageTimer timer(timings);
+
+  // Профиль Fast: серый, выравнивание и бинаризация за два прохода
+  if (profile == PreprocessProfile::Fast) {
+    buffers.fused.to_gray(image);
+    timer.lap("preprocess_gray");
+    buffers.fused.threshold(buffers.binary);
+    timer.lap("preprocess_threshold");
+    return buffers.binary;
+  }
+
+  // Конвертация в оттенки серого
+  const cv::Mat *gray = &image;
+  if (image.channels() != 1) {
+    cv::cvtColor(image, buffers.gray,
+                 image.channels() == 4 ? cv::COLOR_BGRA2GRAY
+                                       : cv::COLOR_BGR2GRAY);
+    gray = &buffers.gray;
+  }
+  timer.lap("preprocess_gray");
+
+  // Удаление шума
+  cv::fastNlMeansDenoising(*gray, buffers.denoised, 10, 7, 21);
+  timer.lap("preprocess_denoise");
+
+  // Улучшение контраста
+  cv::equalizeHist(buffers.denoised, buffers.equalized);
+  timer.lap("preprocess_equalize");
+
+  // Адаптивная бинаризация
+  cv::adaptiveThreshold(buffers.equalized, buffers.binary, 255,
+                        cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY, 11,
+                        2);
+  timer.lap("preprocess_threshold");
+
+  return buffers.binary;
+}
+
+// Завершённый скан — в метрики процесса
+inline void record_metrics(const ScanResult &result) {
+  Metrics::global().record_scan(result.success, result.error_code,
+                                result.cache_hit, result.processing_time_ms,
+                                result.timings);
+}
+
+// Этапы до OCR: выравнивание страницы и предобработка. Движок Tesseract
+// не нужен, поэтому в конвейере они выполняются в своих потоках.
+inline const cv::Mat &prepare_page(const cv::Mat &image,
+                                   const ScannerOptions &options,
+                                   WorkBuffers &buffers, ScanResult &result) {
+  // 1a. Проверка пригодности: непригодный снимок не тратит время на
+  // шумоподавление и OCR
+  if (options.quality_gate != QualityGateMode::Off) {
+    StageTimer timer(result.timings);
+    result.quality = buffers.quality_gate.check(image);
+    timer.lap("quality_gate");
+    // В режиме Flag причина остаётся в error_code успешного результата
+    result.error_code = result.quality.reason;
+    if (!result.quality.usable() &&
+        options.quality_gate == QualityGateMode::Reject) {
+      throw std::runtime_error(result.quality.message());
+    }
+  }
+
+  // 2. Выравнивание страницы
+  const cv::Mat *page = &image;
+  if (options.align_page) {
+    StageTimer timer(result.timings);
+    AlignmentResult aligned =
+        make_aligner(options).align(image, buffers.page, buffers.reduced);
+    timer.lap("align");
+
+    result.page_found = aligned.page_found;
+    result.homography.assign(aligned.homography.ptr<double>(),
+                             aligned.homography.ptr<double>() + 9);
+    page = &buffers.page;
+  }
+
+  // 3. Предобработка; первый проход двухпроходного режима — дешёвая,
+  // с более мелким текстом
+  PreprocessProfile profile = options.preprocess_profile;
+  int text_height = options.target_text_height;
+  if (options.two_pass) {
+    profile = PreprocessProfile::Fast;
+    text_height = text_height > 0
+                      ? std::min(text_height, fast_pass_text_height)
+                      : fast_pass_text_height;
+  }
+  const cv::Mat &binary = preprocess_image(
+      *page, profile, options.preprocess_backend, buffers, result.timings);
+  if (text_height <= 0) {
+    return binary;
+  }
+
+  // 3a. Уменьшение до рабочего разрешения OCR
+  StageTimer timer(result.timings);
+  TextScale text_scale = buffers.text_scale.estimate(binary, text_height);
+  result.text_height = text_scale.text_height;
+  result.ocr_scale = text_scale.scale;
+  result.source_ppi = text_scale.source_ppi;
+
+  const cv::Mat *processed = &binary;
+  if (text_scale.scale < 1.0) {
+    cv::resize(binary, buffers.scaled, cv::Size(), text_scale.scale,
+               text_scale.scale, cv::INTER_AREA);
+    processed = &buffers.scaled;
+  }
+  timer.lap("normalize_resolution");
+  return *processed;
+}
+
 class MUZLOTO_EXPORT MuzlotoScanner {
 private:
   std::unique_ptr<tesseract::TessBaseAPI> ocr;
+  // Второй движок для полей с узким алфавитом (режим шаблона)
+  std::unique_ptr<tesseract::TessBaseAPI> latin_ocr;
+  bool latin_unavailable = false;
+  // Быстрые модели для первого прохода двухпроходного режима
+  std::unique_ptr<tesseract::TessBaseAPI> fast_ocr;
+  std::string fast_ocr_path;
+  // Основной движок учтён в Metrics с оценкой памяти engine_memory
+  bool engine_counted = false;
+  int64_t engine_memory = 0;
   bool initialized;
-
-  // Точные названия полей из анкеты
-  const std::vector<std::pair<std::string, std::string>> field_mapping = {
-      {"Дата:", "date"},
-      {"Номер столика:", "table_number"},
-      {"Место игры:", "location"},
-      {"Довольны ли вы посещением Музлото?", "satisfaction_rating"},
-      {"Понравился ли вам плейлист?", "playlist_rating"},
-      {"Какие треки вы бы добавили?", "tracks_to_add"},
-      {"Понравилась ли вам локация?", "location_rating"},
-      {"Понравилась ли вам кухня и бар?", "kitchen_rating"},
-      {"Устроил ли вас сервис, время подачи?", "service_rating"},
-      {"Понравилась ли вам работа ведущего?", "host_rating"},
-      {"Сколько раз вы были на Музлото?", "visits_count"},
-      {"Оцените стоимость игры за билет", "ticket_price"},
-      {"Знаете ли вы, что Музлото можно заказать на корпоратив или день "
-       "рождения",
-       "know_booking"},
-      {"Откуда вы о нас узнали?", "source_info"},
-      {"Ради чего вы обычно ходите на подобные вечеринки?", "purpose"},
-      {"Что нам стоит улучшить?", "improvements"},
-      {"Если вы хотите, чтобы мы с вами связались - оставьте ваш номер "
-       "телефона.",
-       "phone_number"}};
+  int lease_timeout_ms = -1;
+  std::string tessdata_path;
+  // Каталог и файлы моделей основного движка — для отпечатка кэша
+  std::string model_signature;
+  ScannerOptions options;
+  // Шаблон, загруженный load_form_template: переживает смену схемы
+  std::shared_ptr<const FormTemplate> loaded_template;
+  WorkBuffers buffers;
+
+  // Общий дескриптор (muzloto_create_pooled): у самого сканера движка нет,
+  // каждый скан берёт свободный движок из idle и возвращает его после
+  // скана. Так несколько потоков делят небольшой набор прогретых движков.
+  struct SharedEngines {
+    std::vector<std::unique_ptr<MuzlotoScanner>> scanners;
+    BoundedQueue<MuzlotoScanner *> idle;
+    WorkerLoad load; // для метрик: ждущие и занятые вызовы
+    // Сколько ждать свободного движка, мс; < 0 — без ограничения
+    int timeout_ms = -1;
+  };
+  std::unique_ptr<SharedEngines> shared;
+  size_t shared_size = 0;
+
+  // Движок, взятый из SharedEngines на время одного скана
+  class EngineLease {
+  public:
+    EngineLease(SharedEngines &engines, MuzlotoScanner *engine)
+        : engines(engines), engine(engine) {}
+    ~EngineLease() { engines.idle.push(engine); }
+    EngineLease(const EngineLease &) = delete;
+    EngineLease &operator=(const EngineLease &) = delete;
+
+    MuzlotoScanner &operator*() const { return *engine; }
+
+  private:
+    SharedEngines &engines;
+    MuzlotoScanner *engine;
+  };
 
 public:
-  MuzlotoScanner() : initialized(false) {
+  // shared_engines > 0 — общий дескриптор на столько движков (создаются
+  // в initialize)
+  explicit MuzlotoScanner(size_t shared_engines = 0)
+      : initialized(false), shared_size(shared_engines) {
     ocr = std::make_unique<tesseract::TessBaseAPI>();
   }
 
   ~MuzlotoScanner() {
+    if (shared) {
+      Metrics::global().detach_pool(this);
+    }
+    if (engine_counted) {
+      Metrics::global().add_engines(-1, -engine_memory);
+    }
+    if (fast_ocr) {
+      fast_ocr->End();
+    }
+    if (latin_ocr) {
+      latin_ocr->End();
+    }
     if (ocr) {
       ocr->End();
     }
   }
 
-  bool initialize(const std::string &tessdata_path = "") {
+  bool initialize(const std::string &path = "") {
+    if (shared_size > 0) {
+      return initialize_shared(path);
+    }
     try {
       // Инициализация Tesseract с русским языком
-      if (ocr->Init(tessdata_path.empty() ? NULL : tessdata_path.c_str(),
-                    "rus+eng", tesseract::OEM_LSTM_ONLY) != 0) {
+      if (init_engine(*ocr, path, "rus+eng") != 0) {
         return false;
       }
+      tessdata_path = path;
+      const char *datapath = ocr->GetDatapath();
+      model_signature = describe_models(datapath ? datapath : path);
 
-      // Настройки для анкет
-      ocr->SetPageSegMode(tesseract::PSM_AUTO);
-      ocr->SetVariable("preserve_interword_spaces", "1");
-      ocr->SetVariable("textord_tabfind_find_tables", "1");
-      ocr->SetVariable("textord_tablefind_recognize_tables", "1");
+      configure_page_engine(*ocr);
 
       initialized = true;
       return true;
@@ -121,341 +550,2552 @@ public:
     }
   }
 
-  ScanResult scan_image(const std::string &image_path) {
-    ScanResult result;
-    auto start_time = std::chrono::high_resolution_clock::now();
-
-    try {
-      if (!initialized) {
-        throw std::runtime_error("Сканер не инициализирован");
-      }
+  bool is_initialized() const { return initialized; }
 
-      // 1. Загрузка изображения
-      cv::Mat image = cv::imread(image_path, cv::IMREAD_COLOR);
-      if (image.empty()) {
-        throw std::runtime_error("Не удалось загрузить изображение: " +
-                                 image_path);
-      }
-
-      // 2. Предобработка
-      cv::Mat processed = preprocess_image(image);
+  bool is_shared() const { return shared_size > 0; }
 
-      // 3. Распознавание текста
-      ocr->SetImage(processed.data, processed.cols, processed.rows,
-                    processed.channels(), processed.step);
+  // Сколько ждать свободного движка общего дескриптора; по истечении скан
+  // завершается ошибкой с кодом "busy". < 0 — ждать без ограничения.
+  void set_lease_timeout(int timeout_ms) {
+    lease_timeout_ms = timeout_ms;
+    if (shared) {
+      shared->timeout_ms = timeout_ms;
+    }
+  }
 
-      char *text = ocr->GetUTF8Text();
-      result.raw_text = text ? std::string(text) : "";
-      delete[] text;
+  // Учитывает основной движок в метриках; bytes — оценка его памяти
+  void count_engine(int64_t bytes) {
+    if (engine_counted) {
+      Metrics::global().add_engines(-1, -engine_memory);
+    }
+    engine_counted = true;
+    engine_memory = bytes;
+    Metrics::global().add_engines(1, bytes);
+  }
 
-      // 4. Парсинг анкеты Muzloto
-      parse_muzloto_form(result);
+private:
+  // Движки общего дескриптора инициализируются параллельно, каждый своим
+  // потоком, как в ScannerPool. Память, на которую вырос процесс, делится
+  // между ними поровну.
+  bool initialize_shared(const std::string &path) {
+    if (shared) {
+      return initialized;
+    }
+    auto engines = std::make_unique<SharedEngines>();
+    engines->timeout_ms = lease_timeout_ms;
+    engines->scanners.resize(shared_size);
+    for (auto &scanner : engines->scanners) {
+      scanner = std::make_unique<MuzlotoScanner>();
+    }
 
-      // 5. Обработка ответов
-      extract_answers(result);
+    std::atomic<size_t> failed(0);
+    const int64_t resident_before = process_resident_bytes();
+    {
+      ModelCache::Scope models; // модели читаются с диска один раз
+      WaitGroup started(shared_size);
+      ThreadPool init(shared_size, [&](size_t worker) {
+        if (!engines->scanners[worker]->initialize(path)) {
+          failed++;
+        }
+        started.done();
+      });
+      started.wait();
+    }
+    if (failed > 0) {
+      return false;
+    }
+    const int64_t share =
+        std::max<int64_t>(0, process_resident_bytes() - resident_before) /
+        static_cast<int64_t>(shared_size);
+    for (auto &scanner : engines->scanners) {
+      scanner->count_engine(share);
+      engines->idle.push(scanner.get());
+    }
 
-      result.success = true;
+    tessdata_path = path;
+    model_signature = engines->scanners.front()->model_signature;
+    shared = std::move(engines);
+    initialized = true;
+    Metrics::global().attach_pool(this, "shared", [this] {
+      return Metrics::PoolSample{static_cast<int64_t>(shared_size),
+                                 shared->load.busy, shared->load.queued,
+                                 shared->load.busy_ns / 1e9};
+    });
+    return true;
+  }
 
-    } catch (const std::exception &e) {
+  // Скан на свободном движке общего дескриптора с текущими настройками.
+  // Если движки не освободились за timeout_ms — ошибка "busy".
+  template <typename ScanFn> ScanResult with_engine(ScanFn scan) {
+    SharedEngines &engines = *shared;
+    MuzlotoScanner *engine = nullptr;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    engines.load.queued++;
+    const auto timeout = std::chrono::milliseconds(engines.timeout_ms);
+    const bool leased = engines.timeout_ms < 0
+                            ? engines.idle.pop(engine)
+                            : engines.idle.pop_for(engine, timeout);
+    if (!leased) {
+      engines.load.queued--;
+      ScanResult result;
+      result.schema = options.schema;
       result.success = false;
-      result.error_message = e.what();
+      result.error_code = "busy";
+      result.error_message = "Все движки сканера заняты";
+      result.processing_time_ms =
+          std::chrono::duration<double, std::milli>(
+              std::chrono::high_resolution_clock::now() - start_time)
+              .count();
+      record_metrics(result);
+      return result;
     }
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    result.processing_time_ms =
-        std::chrono::duration<double, std::milli>(end_time - start_time)
-            .count();
-
-    return result;
+    EngineLease lease(engines, engine);
+    BusyScope busy(engines.load);
+    (*lease).set_options(options);
+    return scan(*lease);
   }
 
-private:
-  cv::Mat preprocess_image(const cv::Mat &image) {
-    cv::Mat gray, denoised, binary;
-
-    // Конвертация в оттенки серого
-    cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-
-    // Удаление шума
-    cv::fastNlMeansDenoising(gray, denoised, 10, 7, 21);
-
-    // Улучшение контраста
-    cv::Mat equalized;
-    cv::equalizeHist(denoised, equalized);
-
-    // Адаптивная бинаризация
-    cv::adaptiveThreshold(equalized, binary, 255,
-                          cv::ADAPTIVE_THRESH_GAUSSIAN_C, cv::THRESH_BINARY, 11,
-                          2);
+  // Модели из явно указанного каталога читаются через ModelCache: пока
+  // пул запускает движки (ModelCache::Scope), с диска их загружает только
+  // первый, после запуска буферы освобождаются. Веса сети каждый движок
+  // разворачивает в своей памяти — общим остаётся только чтение файлов.
+  // FileReader с std::vector<char> появился в Tesseract 5;
+  // в 4.x (STRING / GenericVector) модели читаются с диска, как раньше.
+  static int init_engine(tesseract::TessBaseAPI &engine,
+                         const std::string &path, const char *languages) {
+#if defined(TESSERACT_MAJOR_VERSION) && TESSERACT_MAJOR_VERSION >= 5
+    if (!path.empty()) {
+      // data_size == 0: data — путь к tessdata, файлы читает reader
+      return engine.Init(path.c_str(), 0, languages, tesseract::OEM_LSTM_ONLY,
+                         nullptr, 0, nullptr, nullptr, false,
+                         &ModelCache::read_file);
+    }
+#endif
+    return engine.Init(path.empty() ? NULL : path.c_str(), languages,
+                       tesseract::OEM_LSTM_ONLY);
+  }
 
-    return binary;
+  // Каталог моделей и размер и время изменения их файлов: другие модели в
+  // том же каталоге кэша не должны отдавать прежние результаты
+  static std::string describe_models(const std::string &directory) {
+    std::string description = directory;
+    std::string prefix = directory;
+    if (!prefix.empty() && prefix.back() != '/') {
+      prefix += '/';
+    }
+    for (const char *language : {"rus", "eng"}) {
+      const auto state =
+          FolderWatcher::file_state(prefix + language + ".traineddata");
+      description.append(":").append(language).append("=");
+      description += std::to_string(state.size) + "@" +
+                     std::to_string(state.mtime);
+    }
+    return description;
   }
 
-  void parse_muzloto_form(ScanResult &result) {
-    // Разбиваем текст на строки
-    std::vector<std::string> lines;
-    std::stringstream ss(result.raw_text);
-    std::string line;
+  // Настройки для анкет
+  static void configure_page_engine(tesseract::TessBaseAPI &engine) {
+    engine.SetPageSegMode(tesseract::PSM_AUTO);
+    engine.SetVariable("preserve_interword_spaces", "1");
+    engine.SetVariable("textord_tabfind_find_tables", "1");
+    engine.SetVariable("textord_tablefind_recognize_tables", "1");
+  }
 
-    while (std::getline(ss, line)) {
-      // Очистка строки
-      line.erase(std::remove_if(line.begin(), line.end(),
-                                [](char c) { return c == '\n' || c == '\r'; }),
-                 line.end());
+  // Движок первого прохода: быстрые модели из options.fast_tessdata_path
+  // (создаётся при первом скане) или основной, если каталог не задан или
+  // модели не загрузились
+  tesseract::TessBaseAPI &first_pass_engine() {
+    if (!options.two_pass || options.fast_tessdata_path.empty()) {
+      return *ocr;
+    }
+    if (fast_ocr_path != options.fast_tessdata_path) {
+      fast_ocr_path = options.fast_tessdata_path;
+      fast_ocr.reset();
+      auto engine = std::make_unique<tesseract::TessBaseAPI>();
+      if (init_engine(*engine, fast_ocr_path, "rus+eng") == 0) {
+        configure_page_engine(*engine);
+        fast_ocr = std::move(engine);
+      } else {
+        std::cerr << "Быстрые модели недоступны в " << fast_ocr_path
+                  << ", первый проход идёт основным движком" << std::endl;
+      }
+    }
+    return fast_ocr ? *fast_ocr : *ocr;
+  }
 
-      if (!line.empty()) {
-        lines.push_back(line);
+  // Движок "eng" для полей из цифр; создаётся при первой такой области.
+  // Если модели eng нет, поля распознаются основным движком.
+  tesseract::TessBaseAPI *latin_engine() {
+    if (!latin_ocr && !latin_unavailable) {
+      auto engine = std::make_unique<tesseract::TessBaseAPI>();
+      if (init_engine(*engine, tessdata_path, "eng") == 0) {
+        latin_ocr = std::move(engine);
+      } else {
+        std::cerr << "Модель eng недоступна, поля из цифр распознаются "
+                     "основным движком"
+                  << std::endl;
+        latin_unavailable = true;
       }
     }
+    return latin_ocr.get();
+  }
 
-    // Словарь для хранения ответов
-    std::unordered_map<std::string, std::string> answers;
+public:
 
-    // Ищем вопросы и следующие за ними ответы
-    for (size_t i = 0; i < lines.size(); i++) {
-      std::string current_line = lines[i];
-
-      for (const auto &[question, field_id] : field_mapping) {
-        if (current_line.find(question) != std::string::npos) {
-          FieldResult field;
-          field.name = question;
-
-          // Ищем ответ - следующая непустая строка
-          std::string answer_value = "";
-          for (size_t j = i + 1; j < lines.size(); j++) {
-            if (!lines[j].empty()) {
-              // Проверяем, не является ли следующая строка новым вопросом
-              bool is_next_question = false;
-              for (const auto &[next_q, _] : field_mapping) {
-                if (lines[j].find(next_q) != std::string::npos) {
-                  is_next_question = true;
-                  break;
-                }
-              }
-
-              if (!is_next_question) {
-                answer_value = lines[j];
-                i = j; // Пропускаем обработанный ответ
-                break;
-              }
-            }
-          }
+  const std::string &get_tessdata_path() const { return tessdata_path; }
 
-          field.value = answer_value;
-          field.confidence = 0.9f;
-          result.fields.push_back(field);
-          answers[field_id] = answer_value;
-          break;
-        }
-      }
-    }
+  const ScannerOptions &get_options() const { return options; }
 
-    // Заполняем структуру
-    result.date = answers["date"];
-    result.table_number = answers["table_number"];
-    result.location = answers["location"];
-    result.satisfaction_rating = extract_rating(answers["satisfaction_rating"]);
-    result.playlist_rating = extract_rating(answers["playlist_rating"]);
-    result.tracks_to_add = answers["tracks_to_add"];
-    result.location_rating = extract_rating(answers["location_rating"]);
-    result.kitchen_rating = extract_rating(answers["kitchen_rating"]);
-    result.service_rating = extract_rating(answers["service_rating"]);
-    result.host_rating = extract_rating(answers["host_rating"]);
-    result.visits_count = answers["visits_count"];
-    result.ticket_price = extract_ticket_price(answers["ticket_price"]);
-    result.know_booking = extract_yes_no(answers["know_booking"]);
-    result.source_info = answers["source_info"];
-    result.purpose = answers["purpose"];
-    result.improvements = answers["improvements"];
-    result.phone_number = extract_phone_number(answers["phone_number"]);
+  void set_options(const ScannerOptions &new_options) {
+    options = new_options;
   }
 
-  void extract_answers(ScanResult &result) {
-    // Дополнительная обработка ответов
-    if (!result.phone_number.empty()) {
-      result.phone_number = normalize_phone(result.phone_number);
-    }
+  void set_preprocess_profile(PreprocessProfile profile) {
+    options.preprocess_profile = profile;
   }
 
-  std::string extract_rating(const std::string &text) {
-    if (text.empty())
-      return "";
+  void set_preprocess_backend(PreprocessBackend backend) {
+    options.preprocess_backend = backend;
+  }
 
-    // Ищем числа от 1 до 10
-    std::regex rating_regex(R"((10|[1-9]))");
-    std::smatch match;
+  PreprocessBackend preprocess_backend() const {
+    return options.preprocess_backend;
+  }
 
-    if (std::regex_search(text, match, rating_regex)) {
-      return match.str();
-    }
+  void set_quality_gate(QualityGateMode mode) { options.quality_gate = mode; }
 
-    return text;
+  void set_two_pass(bool enabled, const std::string &fast_tessdata_path) {
+    options.two_pass = enabled;
+    options.fast_tessdata_path = fast_tessdata_path;
   }
 
-  std::string extract_ticket_price(const std::string &text) {
-    if (text.empty())
-      return "";
+  void set_target_text_height(int pixels) {
+    options.target_text_height = std::max(0, pixels);
+  }
 
-    std::string lower_text = text;
-    std::transform(lower_text.begin(), lower_text.end(), lower_text.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
+  void set_page_alignment(bool enabled, int page_width = 0,
+                          int page_height = 0) {
+    options.align_page = enabled;
+    options.page_width = page_width;
+    options.page_height = page_height;
+  }
 
-    if (lower_text.find("можно смело ставить дороже") != std::string::npos ||
-        lower_text.find("дороже") != std::string::npos) {
-      return "можно смело ставить дороже";
-    } else if (lower_text.find("доступно") != std::string::npos) {
-      return "доступно";
-    } else if (lower_text.find("дорого") != std::string::npos) {
-      return "дорого";
+  // Включает режим шаблона; пустой путь возвращает области схемы, а если
+  // их нет — распознавание всей страницы
+  bool load_form_template(const std::string &path) {
+    if (path.empty()) {
+      loaded_template.reset();
+      options.form_template = options.schema->layout();
+      return true;
     }
 
-    return text;
-  }
+    try {
+      auto form =
+          std::make_shared<const FormTemplate>(FormTemplate::load(path));
+      options.form_template = bind_template(*form, *options.schema);
+      loaded_template = form;
+      return true;
 
-  std::string extract_yes_no(const std::string &text) {
-    if (text.empty())
-      return "";
+    } catch (const std::exception &e) {
+      std::cerr << "Ошибка загрузки шаблона: " << e.what() << std::endl;
+      return false;
+    }
+  }
 
-    std::string lower_text = text;
-    std::transform(lower_text.begin(), lower_text.end(), lower_text.begin(),
-                   [](unsigned char c) { return std::tolower(c); });
+  // Схема анкеты из JSON; пустой путь возвращает встроенную. Шаблон,
+  // загруженный load_form_template, остаётся и привязывается к полям новой
+  // схемы (ошибка, если его поля в ней нет); без него действуют области
+  // из самой схемы. Порядок загрузки схемы и шаблона не важен.
+  bool load_schema(const std::string &path) {
+    try {
+      auto schema =
+          path.empty() ? FormSchema::builtin() : FormSchema::load(path);
+      auto form = loaded_template ? bind_template(*loaded_template, *schema)
+                                  : schema->layout();
+      options.schema = std::move(schema);
+      options.form_template = std::move(form);
+      return true;
 
-    if (lower_text.find("да") != std::string::npos ||
-        lower_text.find("yes") != std::string::npos ||
-        lower_text.find("✓") != std::string::npos ||
-        lower_text.find("+") != std::string::npos ||
-        lower_text.find("v") != std::string::npos ||
-        lower_text.find("x") != std::string::npos) {
-      return "Да";
-    } else if (lower_text.find("нет") != std::string::npos ||
-               lower_text.find("no") != std::string::npos) {
-      return "Нет";
+    } catch (const std::exception &e) {
+      std::cerr << "Ошибка загрузки схемы: " << e.what() << std::endl;
+      return false;
     }
+  }
 
-    return text;
+  const FormSchema &schema() const { return *options.schema; }
+
+  ScanResult scan_image(const std::string &image_path) {
+    if (shared) {
+      return with_engine([&image_path](MuzlotoScanner &engine) {
+        return engine.scan_image(image_path);
+      });
+    }
+    if (options.result_cache) {
+      return scan_image_cached(image_path, *options.result_cache);
+    }
+    return scan_with("imread", [&image_path] {
+      return load_image(image_path);
+    });
   }
 
-  std::string extract_phone_number(const std::string &text) {
-    if (text.empty())
-      return "";
+  // Кэш результатов; NULL/пустой каталог отключает его. Нужно вызвать до
+  // создания пула, чтобы рабочие сканеры получили тот же кэш.
+  bool set_result_cache(const std::string &directory, size_t max_bytes) {
+    if (directory.empty()) {
+      options.result_cache.reset();
+      return true;
+    }
+    try {
+      options.result_cache =
+          std::make_shared<ResultCache>(directory, max_bytes);
+      return true;
+    } catch (const std::exception &e) {
+      std::cerr << "Ошибка открытия кэша: " << e.what() << std::endl;
+      return false;
+    }
+  }
 
-    // Простая экстракция телефона
-    std::regex phone_regex(
-        R"((\+7|8)[\s\-\(]?(\d{3})[\s\-\)]?(\d{3})[\s\-]?(\d{2})[\s\-]?(\d{2}))");
-    std::smatch match;
+  // Отпечаток всего, что влияет на результат: версия движка и его модели,
+  // схема вопросов и настройки распознавания. Смена любого из них делает
+  // прежние записи кэша недействительными.
+  uint64_t config_fingerprint() const {
+    std::string description = "muzloto-cache-3|";
+    description += tesseract::TessBaseAPI::Version();
+    description += "|models=" + model_signature;
+    description += "|schema=" + options.schema->description();
+    const int profile = static_cast<int>(options.preprocess_profile);
+    const int gate = static_cast<int>(options.quality_gate);
+    description += "|profile=" + std::to_string(profile) + ":" +
+                   backend_name(options.preprocess_backend) +
+                   "|align=" + std::to_string(options.align_page) + ":" +
+                   std::to_string(options.page_width) + "x" +
+                   std::to_string(options.page_height) +
+                   "|text_height=" +
+                   std::to_string(options.target_text_height) +
+                   "|gate=" + std::to_string(gate) +
+                   "|two_pass=" + std::to_string(options.two_pass);
+    if (options.two_pass && !options.fast_tessdata_path.empty()) {
+      description += ":" + describe_models(options.fast_tessdata_path);
+    }
 
-    if (std::regex_search(text, match, phone_regex)) {
-      return match.str();
+    if (options.form_template) {
+      const FormTemplate &form = *options.form_template;
+      description += "|template=" + form.name;
+      for (const auto &field : form.fields) {
+        description.append("|").append(field.id);
+        for (float v : {field.x, field.y, field.width, field.height}) {
+          description.append(":").append(std::to_string(v));
+        }
+        description += ":" + std::to_string(static_cast<int>(field.psm)) +
+                       ":" + std::to_string(static_cast<int>(field.type));
+        for (const auto &mark : field.marks) {
+          description.append(":").append(mark);
+        }
+        for (float edge : field.mark_edges) {
+          description.append(":").append(std::to_string(edge));
+        }
+      }
     }
+    return hash::xxh64(description);
+  }
 
-    return "";
+  // Сканирование уже загруженного изображения или его области (например,
+  // одной анкеты из PageSplitter); ROI не копируется
+  ScanResult scan_mat(const cv::Mat &image) {
+    if (shared) {
+      return with_engine(
+          [&image](MuzlotoScanner &engine) { return engine.scan_mat(image); });
+    }
+    return scan_with("split", [&image] {
+      if (image.empty()) {
+        throw std::runtime_error("Пустая область изображения");
+      }
+      return image;
+    });
   }
 
-  std::string normalize_phone(const std::string &phone) {
-    std::string normalized = phone;
+  // Сканирование закодированного изображения (JPEG, PNG...) из памяти
+  ScanResult scan_encoded(const uint8_t *data, size_t size) {
+    if (shared) {
+      return with_engine([data, size](MuzlotoScanner &engine) {
+        return engine.scan_encoded(data, size);
+      });
+    }
+    return scan_with("imdecode", [data, size] {
+      if (!data || size == 0) {
+        throw std::runtime_error("Пустой буфер изображения");
+      }
+      // Заголовок над чужим буфером, без копирования
+      cv::Mat buffer(1, static_cast<int>(size), CV_8UC1,
+                     const_cast<uint8_t *>(data));
+      cv::Mat image = cv::imdecode(buffer, cv::IMREAD_COLOR);
+      if (image.empty()) {
+        throw std::runtime_error("Не удалось декодировать изображение");
+      }
+      return image;
+    });
+  }
 
-    // Убираем все нецифровые символы кроме +
-    normalized.erase(
-        std::remove_if(normalized.begin(), normalized.end(),
-                       [](char c) { return !std::isdigit(c) && c != '+'; }),
-        normalized.end());
+  // Сканирование уже декодированных пикселей: 1 (серый), 3 (BGR) или 4
+  // (BGRA) канала, stride — байт на строку. Буфер не копируется.
+  ScanResult scan_pixels(const uint8_t *pixels, int width, int height,
+                         int channels, size_t stride) {
+    if (shared) {
+      return with_engine([=](MuzlotoScanner &engine) {
+        return engine.scan_pixels(pixels, width, height, channels, stride);
+      });
+    }
+    return scan_with("wrap_pixels", [=] {
+      if (!pixels || width <= 0 || height <= 0) {
+        throw std::runtime_error("Пустой буфер пикселей");
+      }
+      if (channels != 1 && channels != 3 && channels != 4) {
+        throw std::runtime_error("Неподдерживаемое число каналов: " +
+                                 std::to_string(channels));
+      }
+      if (stride < static_cast<size_t>(width) * channels) {
+        throw std::runtime_error("Шаг строки меньше ширины изображения");
+      }
+      return cv::Mat(height, width, CV_8UC(channels),
+                     const_cast<uint8_t *>(pixels), stride);
+    });
+  }
 
-    // Приводим к формату +7XXXXXXXXXX
-    if (!normalized.empty()) {
-      if (normalized[0] == '8') {
-        normalized[0] = '7';
-        normalized = "+" + normalized;
-      } else if (normalized.substr(0, 2) != "+7") {
-        normalized = "+7" + normalized;
+private:
+  // Копия шаблона с индексами полей схемы по ключам
+  static std::shared_ptr<const FormTemplate>
+  bind_template(const FormTemplate &form, const FormSchema &schema) {
+    auto bound = std::make_shared<FormTemplate>(form);
+    for (auto &field : bound->fields) {
+      int slot = schema.find(field.id);
+      if (slot < 0) {
+        throw std::runtime_error("Поля шаблона " + field.id +
+                                 " нет в схеме " + schema.name());
       }
+      field.slot = static_cast<size_t>(slot);
     }
-
-    return normalized;
+    return bound;
   }
-};
 
-} // namespace muzloto
+  ScanResult scan_image_cached(const std::string &image_path,
+                               ResultCache &cache) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::vector<uint8_t> &bytes = buffers.file_bytes;
+    if (!hash::read_file(image_path, bytes)) {
+      return scan_with("imread", [&image_path] {
+        return load_image(image_path);
+      });
+    }
 
-// C-интерфейс для простого использования
-extern "C" {
-MUZLOTO_EXPORT void *muzloto_create() { return new muzloto::MuzlotoScanner(); }
+    const uint64_t key = hash::combine(
+        hash::xxh64(bytes.data(), bytes.size()), config_fingerprint());
+    auto elapsed_ms = [&start_time] {
+      return std::chrono::duration<double, std::milli>(
+                 std::chrono::high_resolution_clock::now() - start_time)
+          .count();
+    };
+
+    std::string cached;
+    if (cache.get(key, cached)) {
+      try {
+        ScanResult result =
+            result_from_json(json::parse(cached), options.schema);
+        result.cache_hit = true;
+        result.processing_time_ms = elapsed_ms();
+        result.timings = {{"cache_lookup", result.processing_time_ms}};
+        Metrics::global().record_cache(true);
+        record_metrics(result);
+        return result;
+      } catch (const std::exception &) {
+        // повреждённая запись — распознаём заново и перезаписываем
+      }
+    }
+    Metrics::global().record_cache(false);
+    const double lookup_ms = elapsed_ms();
 
-MUZLOTO_EXPORT void muzloto_destroy(void *scanner) {
-  delete static_cast<muzloto::MuzlotoScanner *>(scanner);
+    ScanResult result = scan_with("imread", [&bytes, &image_path] {
+      cv::Mat buffer(1, static_cast<int>(bytes.size()), CV_8UC1, bytes.data());
+      cv::Mat image = cv::imdecode(buffer, cv::IMREAD_COLOR);
+      if (image.empty()) {
+        throw std::runtime_error("Не удалось загрузить изображение: " +
+                                 image_path);
+      }
+      return image;
+    });
+    result.timings.insert(result.timings.begin(), {"cache_lookup", lookup_ms});
+    result.processing_time_ms += lookup_ms;
+
+    if (result.success) {
+      cache.put(key, result_to_json(result).dump());
+    }
+    return result;
+  }
+
+  // Общий каркас сканирования: load() возвращает исходное изображение,
+  // load_stage — имя этапа загрузки в timings
+  template <typename LoadFn>
+  ScanResult scan_with(const char *load_stage, LoadFn load) {
+    ScanResult result;
+    result.schema = options.schema;
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    try {
+      if (!initialized) {
+        throw std::runtime_error("Сканер не инициализирован");
+      }
+
+      // 1. Загрузка изображения
+      StageTimer timer(result.timings);
+      cv::Mat image = load();
+      timer.lap(load_stage);
+      result.image_width = image.cols;
+      result.image_height = image.rows;
+
+      recognize(image, result);
+      result.success = true;
+
+    } catch (const std::exception &e) {
+      result.success = false;
+      result.error_message = e.what();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    result.processing_time_ms =
+        std::chrono::duration<double, std::milli>(end_time - start_time)
+            .count();
+
+    record_metrics(result);
+    return result;
+  }
+
+  void recognize(const cv::Mat &image, ScanResult &result) {
+    recognize_page(prepare_page(image, options, buffers, result), result);
+    refine_weak_fields(options.align_page ? buffers.page : image, result);
+  }
+
+public:
+  // Этапы с движком Tesseract: распознавание подготовленной страницы
+  // (результат prepare_page) и разбор ответов
+  void recognize_page(const cv::Mat &processed, ScanResult &result) {
+    // 4. Распознавание текста
+    StageTimer timer(result.timings);
+    tesseract::TessBaseAPI &engine = first_pass_engine();
+    engine.SetImage(processed.data, processed.cols, processed.rows,
+                    processed.channels(), processed.step);
+    if (result.source_ppi > 0) {
+      engine.SetSourceResolution(result.source_ppi);
+    }
+    timer.lap("set_image");
+
+    if (options.form_template) {
+      // Только области ответов по шаблону — вопросы искать не нужно
+      recognize_template_fields(engine, processed, *options.form_template,
+                                result);
+      timer.lap("recognize");
+    } else {
+      // Строки текста сразу с рамками и уверенностью движка
+      const size_t line_count = read_text_lines(engine, result);
+      timer.lap("recognize");
+      result.ocr_chars = count_utf8_chars(result.raw_text);
+
+      // 5. Парсинг анкеты Muzloto
+      parse_muzloto_form(result, line_count);
+    }
+
+    // 6. Обработка ответов
+    fill_answers(result, buffers.answers);
+    timer.lap("parse");
+  }
+
+  // Второй проход двухпроходного режима. Поля первого прохода с низкой
+  // уверенностью или не прошедшие проверку (оценка не 1–10, телефон не
+  // +7XXXXXXXXXX) распознаются заново: только их область page (снимок
+  // после выравнивания) проходит качественную предобработку и основной
+  // движок. Поле без рамки (вопрос не найден) повторить нельзя.
+  void refine_weak_fields(const cv::Mat &page, ScanResult &result) {
+    if (!options.two_pass || result.ocr_scale <= 0) {
+      return;
+    }
+    StageTimer timer(result.timings);
+    StageTimings refine_timings; // этапы предобработки областей не нужны
+    const double to_page = 1.0 / result.ocr_scale;
+    const cv::Rect page_rect(0, 0, page.cols, page.rows);
+    bool changed = false;
+
+    for (auto &field : result.fields) {
+      if (field.slot < 0 || field.box.empty()) {
+        continue;
+      }
+      const TemplateField *layout = template_field(field.slot);
+      if (layout && layout->type == FieldType::Marks) {
+        continue; // отметки распознаются без OCR
+      }
+      const bool valid = is_valid_answer(field.slot, field.value);
+      if (valid && field.confidence >= refine_confidence) {
+        continue;
+      }
+
+      // Рамка первого прохода — в координатах уменьшенной страницы
+      const int pad = static_cast<int>(field.box.height * to_page / 4) + 2;
+      cv::Rect region(static_cast<int>(field.box.x * to_page) - pad,
+                      static_cast<int>(field.box.y * to_page) - pad,
+                      static_cast<int>(field.box.width * to_page) + 2 * pad,
+                      static_cast<int>(field.box.height * to_page) + 2 * pad);
+      region &= page_rect;
+      if (region.width < 4 || region.height < 4) {
+        continue;
+      }
+
+      const cv::Mat &binary =
+          preprocess_image(page(region), PreprocessProfile::Quality,
+                           options.preprocess_backend, buffers, refine_timings);
+      ocr->SetImage(binary.data, binary.cols, binary.rows, binary.channels(),
+                    binary.step);
+      ocr->SetVariable("tessedit_char_whitelist",
+                       layout ? profile_of(layout->type).whitelist : "");
+      ocr->SetPageSegMode(layout ? layout->psm : tesseract::PSM_SINGLE_LINE);
+
+      std::string value;
+      char *text = ocr->GetUTF8Text();
+      clean_field_text(text, value);
+      delete[] text;
+      const float confidence = ocr->MeanTextConf() / 100.0f;
+
+      // Проверку прошедший ответ лучше непрошедшего, иначе решает
+      // уверенность
+      const bool now_valid = is_valid_answer(field.slot, value);
+      if (value.empty() || (valid && !now_valid) ||
+          (valid == now_valid && confidence <= field.confidence)) {
+        continue;
+      }
+      field.value = value;
+      field.confidence = confidence;
+      buffers.answers[field.slot] = value;
+      result.refined_fields++;
+      changed = true;
+    }
+
+    ocr->SetVariable("tessedit_char_whitelist", "");
+    ocr->SetPageSegMode(tesseract::PSM_AUTO);
+    if (changed) {
+      fill_answers(result, buffers.answers);
+    }
+    timer.lap("refine");
+  }
+
+private:
+  const TemplateField *template_field(int slot) const {
+    if (!options.form_template) {
+      return nullptr;
+    }
+    for (const auto &field : options.form_template->fields) {
+      if (static_cast<int>(field.slot) == slot) {
+        return &field;
+      }
+    }
+    return nullptr;
+  }
+
+  // Проверка ответа по смыслу поля: оценки — число 1–10, телефон —
+  // российский номер после нормализации
+  bool is_valid_answer(int slot, const std::string &value) {
+    switch (options.schema->fields()[slot].kind) {
+    case AnswerKind::Rating:
+      return !extract::find_rating(value).empty();
+    case AnswerKind::Phone: {
+      std::string phone = normalize_phone(extract_phone_number(value));
+      return phone.size() == 12 && phone.compare(0, 2, "+7") == 0;
+    }
+    default:
+      return !value.empty();
+    }
+  }
+
+  // Ответы текущего скана по индексам схемы; строки очищаются, но
+  // сохраняют выделенную память
+  std::vector<std::string> &reset_answers() {
+    buffers.answers.resize(options.schema->size());
+    for (auto &answer : buffers.answers) {
+      answer.clear();
+    }
+    return buffers.answers;
+  }
+
+  // Число символов UTF-8 (байты продолжения не считаются)
+  static size_t count_utf8_chars(const std::string &text) {
+    return std::count_if(text.begin(), text.end(), [](char c) {
+      return (static_cast<unsigned char>(c) & 0xC0) != 0x80;
+    });
+  }
+
+  // Ответ из области шаблона: переводы строк заменяются пробелами
+  static void clean_field_text(const char *text, std::string &cleaned) {
+    cleaned.assign(text ? text : "");
+    std::replace_if(
+        cleaned.begin(), cleaned.end(),
+        [](char c) { return c == '\n' || c == '\r'; }, ' ');
+
+    auto last = cleaned.find_last_not_of(' ');
+    if (last == std::string::npos) {
+      cleaned.clear();
+      return;
+    }
+    cleaned.erase(last + 1);
+    cleaned.erase(0, cleaned.find_first_not_of(' '));
+  }
+
+  void recognize_template_fields(tesseract::TessBaseAPI &page_engine,
+                                 const cv::Mat &page, const FormTemplate &form,
+                                 ScanResult &result) {
+    std::vector<std::string> &answers = reset_answers();
+    bool latin_image_set = false;
+
+    for (const auto &field : form.fields) {
+      int left = static_cast<int>(field.x * page.cols);
+      int top = static_cast<int>(field.y * page.rows);
+      int width = std::min(static_cast<int>(field.width * page.cols),
+                           page.cols - left);
+      int height = std::min(static_cast<int>(field.height * page.rows),
+                            page.rows - top);
+      if (width <= 0 || height <= 0) {
+        continue;
+      }
+
+      const std::string &question =
+          options.schema->fields()[field.slot].question;
+      std::string &value = answers[field.slot];
+
+      // Отметки в ячейках определяются по заполненности, без OCR
+      if (field.type == FieldType::Marks) {
+        MarkResult mark = MarkDetector::detect(
+            page, cv::Rect(left, top, width, height), field.mark_edges);
+        if (mark.index >= 0) {
+          value = field.marks[mark.index];
+        }
+        result.raw_text.append(question).append("\n").append(value).append(
+            "\n");
+        result.fields.push_back({question, value, mark.confidence,
+                                 static_cast<int>(field.slot),
+                                 cv::Rect(left, top, width, height)});
+        continue;
+      }
+
+      // Поля с узким алфавитом — своим движком и списком символов
+      const FieldProfile profile = profile_of(field.type);
+      tesseract::TessBaseAPI *engine = &page_engine;
+      if (profile.latin_engine) {
+        if (tesseract::TessBaseAPI *latin = latin_engine()) {
+          if (!latin_image_set) {
+            latin->SetImage(page.data, page.cols, page.rows, page.channels(),
+                            page.step);
+            if (result.source_ppi > 0) {
+              latin->SetSourceResolution(result.source_ppi);
+            }
+            latin_image_set = true;
+          }
+          engine = latin;
+        }
+      }
+
+      engine->SetVariable("tessedit_char_whitelist", profile.whitelist);
+      engine->SetPageSegMode(field.psm);
+      engine->SetRectangle(left, top, width, height);
+
+      char *text = engine->GetUTF8Text();
+      clean_field_text(text, value);
+      delete[] text;
+
+      result.ocr_chars += count_utf8_chars(value);
+
+      result.raw_text.append(question).append("\n").append(value).append(
+          "\n");
+      result.fields.push_back({question, value,
+                               engine->MeanTextConf() / 100.0f,
+                               static_cast<int>(field.slot),
+                               cv::Rect(left, top, width, height)});
+    }
+
+    page_engine.SetVariable("tessedit_char_whitelist", "");
+    page_engine.SetPageSegMode(tesseract::PSM_AUTO);
+  }
+
+  // Распознаёт страницу и обходит строки текста ResultIterator'ом:
+  // непустые строки с уверенностью и рамкой — в переиспользуемые буферы,
+  // их текст — в raw_text. Возвращает число строк.
+  size_t read_text_lines(tesseract::TessBaseAPI &engine, ScanResult &result) {
+    result.raw_text.clear();
+    if (engine.Recognize(nullptr) != 0) {
+      throw std::runtime_error("Ошибка распознавания страницы");
+    }
+
+    const auto level = tesseract::RIL_TEXTLINE;
+    std::unique_ptr<tesseract::ResultIterator> it(engine.GetIterator());
+    size_t count = 0;
+    if (!it || it->Empty(level)) {
+      return 0;
+    }
+
+    do {
+      char *text = it->GetUTF8Text(level);
+      if (!text) {
+        continue;
+      }
+      size_t length = std::strlen(text);
+      while (length > 0 && (text[length - 1] == '\n' ||
+                            text[length - 1] == '\r')) {
+        length--;
+      }
+
+      if (length > 0) {
+        if (buffers.lines.size() <= count) {
+          buffers.lines.emplace_back();
+          buffers.line_confidences.emplace_back();
+          buffers.line_boxes.emplace_back();
+        }
+        buffers.lines[count].assign(text, length);
+        buffers.line_confidences[count] = it->Confidence(level) / 100.0f;
+
+        int left = 0, top = 0, right = 0, bottom = 0;
+        it->BoundingBox(level, &left, &top, &right, &bottom);
+        buffers.line_boxes[count] =
+            cv::Rect(left, top, right - left, bottom - top);
+
+        result.raw_text.append(text, length).append("\n");
+        count++;
+      }
+      delete[] text;
+    } while (it->Next(level));
+    return count;
+  }
+
+  void parse_muzloto_form(ScanResult &result, size_t line_count) {
+    const std::vector<std::string> &lines = buffers.lines;
+
+    // Ответы по индексам полей
+    std::vector<std::string> &answers = reset_answers();
+
+    // Классифицируем каждую строку за один проход автомата: индекс
+    // вопроса или -1 для строк-ответов
+    const FormSchema &schema = *options.schema;
+    std::vector<int> &line_questions = buffers.line_questions;
+    line_questions.resize(line_count);
+    for (size_t i = 0; i < line_count; i++) {
+      line_questions[i] = schema.matcher().match(lines[i]);
+    }
+
+    // Ищем вопросы и следующие за ними ответы
+    for (size_t i = 0; i < line_count; i++) {
+      if (line_questions[i] < 0) {
+        continue;
+      }
+      const size_t slot = line_questions[i];
+
+      // Ищем ответ - следующая строка, не являющаяся вопросом; её
+      // уверенность и рамка становятся уверенностью и рамкой поля
+      std::string &answer_value = answers[slot];
+      answer_value.clear();
+      float confidence = 0.0f;
+      cv::Rect box;
+      for (size_t j = i + 1; j < line_count; j++) {
+        if (line_questions[j] < 0) {
+          answer_value = lines[j];
+          confidence = buffers.line_confidences[j];
+          box = buffers.line_boxes[j];
+          i = j; // Пропускаем обработанный ответ
+          break;
+        }
+      }
+
+      result.fields.push_back({schema.fields()[slot].question, answer_value,
+                               confidence, static_cast<int>(slot), box});
+    }
+  }
+
+  // Заполняет поля анкеты по ответам в порядке схемы; нормализация — по
+  // типу ответа
+  void fill_answers(ScanResult &result,
+                    const std::vector<std::string> &answers) {
+    const std::vector<SchemaField> &fields = options.schema->fields();
+    result.schema = options.schema;
+    result.answers.resize(fields.size());
+    for (size_t slot = 0; slot < fields.size(); slot++) {
+      result.answers[slot] = normalize_answer(fields[slot], answers[slot]);
+    }
+  }
+
+  std::string normalize_answer(const SchemaField &field,
+                               const std::string &text) {
+    switch (field.kind) {
+    case AnswerKind::Rating:
+      return extract_rating(text);
+    case AnswerKind::YesNo:
+      return extract_yes_no(text);
+    case AnswerKind::Choice:
+      return extract_choice(field.options, text);
+    case AnswerKind::Phone: {
+      std::string phone = extract_phone_number(text);
+      return phone.empty() ? phone : normalize_phone(phone);
+    }
+    default:
+      return text;
+    }
+  }
+
+  std::string extract_rating(const std::string &text) {
+    if (text.empty())
+      return "";
+
+    // Ищем числа от 1 до 10
+    std::string rating = extract::find_rating(text);
+    return rating.empty() ? text : rating;
+  }
+
+  // Первый вариант, ключевое слово которого входит в ответ; иначе ответ
+  // как есть
+  std::string extract_choice(const std::vector<AnswerOption> &options,
+                             const std::string &text) {
+    if (text.empty())
+      return "";
+
+    std::string lower_text = text;
+    std::transform(lower_text.begin(), lower_text.end(), lower_text.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    for (const auto &option : options) {
+      for (const auto &keyword : option.keywords) {
+        if (lower_text.find(keyword) != std::string::npos) {
+          return option.value;
+        }
+      }
+    }
+
+    return text;
+  }
+
+  std::string extract_yes_no(const std::string &text) {
+    if (text.empty())
+      return "";
+
+    std::string lower_text = text;
+    std::transform(lower_text.begin(), lower_text.end(), lower_text.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+
+    if (lower_text.find("да") != std::string::npos ||
+        lower_text.find("yes") != std::string::npos ||
+        lower_text.find("✓") != std::string::npos ||
+        lower_text.find("+") != std::string::npos ||
+        lower_text.find("v") != std::string::npos ||
+        lower_text.find("x") != std::string::npos) {
+      return "Да";
+    } else if (lower_text.find("нет") != std::string::npos ||
+               lower_text.find("no") != std::string::npos) {
+      return "Нет";
+    }
+
+    return text;
+  }
+
+  std::string extract_phone_number(const std::string &text) {
+    if (text.empty())
+      return "";
+
+    // Простая экстракция телефона
+    size_t pos = 0, len = 0;
+    if (extract::find_phone(text, pos, len)) {
+      return text.substr(pos, len);
+    }
+
+    return "";
+  }
+
+  std::string normalize_phone(const std::string &phone) {
+    std::string normalized = phone;
+
+    // Убираем все нецифровые символы кроме +
+    normalized.erase(
+        std::remove_if(normalized.begin(), normalized.end(),
+                       [](char c) { return !std::isdigit(c) && c != '+'; }),
+        normalized.end());
+
+    // Приводим к формату +7XXXXXXXXXX
+    if (!normalized.empty()) {
+      if (normalized[0] == '8') {
+        normalized[0] = '7';
+        normalized = "+" + normalized;
+      } else if (normalized.substr(0, 2) != "+7") {
+        normalized = "+7" + normalized;
+      }
+    }
+
+    return normalized;
+  }
+};
+
+// Результат асинхронного сканирования вместе с меткой вызывающего
+struct AsyncCompletion {
+  int64_t tag = 0;
+  ScanResult result;
+};
+
+// Учитывает в метриках движки пула; память, на которую вырос процесс за
+// параллельную инициализацию (resident_growth), делится между ними поровну
+inline void
+count_engines(const std::vector<std::unique_ptr<MuzlotoScanner>> &scanners,
+              int64_t resident_growth) {
+  int64_t ready = 0;
+  for (const auto &scanner : scanners) {
+    ready += scanner->is_initialized() ? 1 : 0;
+  }
+  if (ready == 0) {
+    return;
+  }
+  const int64_t share = std::max<int64_t>(0, resident_growth) / ready;
+  for (const auto &scanner : scanners) {
+    if (scanner->is_initialized()) {
+      scanner->count_engine(share);
+    }
+  }
+}
+
+// Пул сканеров для пакетной обработки. У каждого рабочего потока свой
+// инициализированный MuzlotoScanner (и, значит, свой TessBaseAPI), поэтому
+// изображения распознаются параллельно без общих блокировок.
+class MUZLOTO_EXPORT ScannerPool {
+private:
+  struct AsyncJob {
+    std::string path;
+    int64_t tag = 0;
+  };
+
+  std::vector<std::unique_ptr<MuzlotoScanner>> scanners;
+  // Асинхронный режим: ещё не взятые в работу задания (ограниченная
+  // очередь — submit() блокируется, когда она полна) и готовые результаты
+  BoundedQueue<AsyncJob> submissions;
+  BoundedQueue<AsyncCompletion> completions;
+  std::atomic<size_t> outstanding;
+  std::atomic<size_t> failed_workers;
+  WorkerLoad load; // для метрик: очередь и занятость потоков
+  // Последним: разрушается первым и дожидается задач, которые ещё
+  // обращаются к load и очередям выше
+  std::unique_ptr<ThreadPool> pool;
+
+  // Задача пула с учётом в load
+  template <typename Fn> void enqueue(Fn task) {
+    load.queued++;
+    pool->submit([this, task = std::move(task)](size_t worker) mutable {
+      BusyScope busy(load);
+      task(worker);
+    });
+  }
+
+public:
+  // Рабочие сканеры повторяют настройки prototype. Инициализация Tesseract
+  // выполняется параллельно, каждым потоком для своего движка.
+  // queue_capacity — сколько заданий submit() может ждать свободного
+  // потока (0 — два на поток).
+  ScannerPool(const MuzlotoScanner &prototype, size_t n_workers,
+              size_t queue_capacity = 0)
+      : scanners(worker_count(n_workers)),
+        submissions(queue_capacity > 0 ? queue_capacity
+                                       : 2 * scanners.size()),
+        outstanding(0), failed_workers(0) {
+    n_workers = scanners.size();
+    for (auto &scanner : scanners) {
+      scanner = std::make_unique<MuzlotoScanner>();
+    }
+
+    const std::string tessdata_path = prototype.get_tessdata_path();
+    const ScannerOptions options = prototype.get_options();
+    const int64_t resident_before = process_resident_bytes();
+    {
+      ModelCache::Scope models; // модели читаются с диска один раз
+      WaitGroup started(n_workers);
+      pool = std::make_unique<ThreadPool>(
+          n_workers, [this, &started, tessdata_path, options](size_t worker) {
+            if (!scanners[worker]->initialize(tessdata_path)) {
+              failed_workers++;
+            }
+            scanners[worker]->set_options(options);
+            started.done();
+          });
+      started.wait();
+    }
+    count_engines(scanners, process_resident_bytes() - resident_before);
+
+    Metrics::global().attach_pool(this, "scanner", [this] {
+      return Metrics::PoolSample{static_cast<int64_t>(scanners.size()),
+                                 load.busy, load.queued,
+                                 load.busy_ns / 1e9};
+    });
+  }
+
+  ~ScannerPool() { Metrics::global().detach_pool(this); }
+
+  ScannerPool(const ScannerPool &) = delete;
+  ScannerPool &operator=(const ScannerPool &) = delete;
+
+  bool is_ready() const { return failed_workers == 0; }
+
+  size_t size() const { return scanners.size(); }
+
+  const std::shared_ptr<const FormSchema> &schema() const {
+    return scanners.front()->get_options().schema;
+  }
+
+  std::vector<ScanResult> scan_batch(const std::vector<std::string> &paths) {
+    std::vector<ScanResult> results(paths.size());
+    WaitGroup pending(paths.size());
+
+    for (size_t i = 0; i < paths.size(); i++) {
+      enqueue([this, &paths, &results, &pending, i](size_t worker) {
+        results[i] = scanners[worker]->scan_image(paths[i]);
+        pending.done();
+      });
+    }
+
+    pending.wait();
+    return results;
+  }
+
+  // Многостраничные файлы и снимки с несколькими анкетами: каждая
+  // страница (cv::imreadmulti) делится на анкеты, и все анкеты всех
+  // файлов распознаются пулом параллельно. Результаты — по файлам, внутри
+  // файла по страницам и анкетам в порядке чтения.
+  std::vector<ScanResult>
+  scan_documents(const std::vector<std::string> &paths) {
+    std::vector<std::vector<ScanResult>> per_path(paths.size());
+    WaitGroup pending(paths.size());
+
+    for (size_t i = 0; i < paths.size(); i++) {
+      enqueue([this, &paths, &per_path, &pending, i](size_t) {
+        split_document(paths[i], per_path[i], pending);
+        pending.done();
+      });
+    }
+    pending.wait();
+
+    std::vector<ScanResult> results;
+    for (auto &document : per_path) {
+      for (auto &result : document) {
+        results.push_back(std::move(result));
+      }
+    }
+    return results;
+  }
+
+  // Ставит изображение в очередь и сразу возвращается; если очередь
+  // полна — ждёт, пока рабочий поток возьмёт следующее задание
+  void submit(const std::string &path, int64_t tag) {
+    outstanding++;
+    submissions.push({path, tag});
+
+    // На каждое задание — ровно одна задача пула, она и заберёт его
+    enqueue([this](size_t worker) {
+      AsyncJob job;
+      if (!submissions.try_pop(job)) {
+        return;
+      }
+      completions.push({job.tag, scanners[worker]->scan_image(job.path)});
+    });
+  }
+
+  // Готовый результат без ожидания
+  bool poll(AsyncCompletion &completion) {
+    return take(completions.try_pop(completion));
+  }
+
+  // Ждёт результат не дольше timeout_ms (< 0 — без ограничения). Сразу
+  // возвращает false, если незабранных заданий нет.
+  bool wait(AsyncCompletion &completion, int timeout_ms) {
+    if (outstanding == 0) {
+      return false;
+    }
+    if (timeout_ms < 0) {
+      return take(completions.pop(completion));
+    }
+    return take(completions.pop_for(completion,
+                                    std::chrono::milliseconds(timeout_ms)));
+  }
+
+  // Отправлено, но ещё не забрано через poll()/wait()
+  size_t pending() const { return outstanding; }
+
+private:
+  static size_t worker_count(size_t n_workers) {
+    return n_workers > 0 ? n_workers
+                         : std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // Декодирует файл, находит анкеты и ставит каждую в пул отдельной
+  // задачей; pending увеличивается до того, как родительская задача
+  // завершится, поэтому scan_documents дождётся всех анкет
+  void split_document(const std::string &path, std::vector<ScanResult> &out,
+                      WaitGroup &pending) {
+    auto start_time = std::chrono::high_resolution_clock::now();
+    struct Form {
+      cv::Mat image; // ROI страницы — страница живёт, пока жив заголовок
+      int page = 0;
+      int form = 0;
+    };
+    std::vector<Form> forms;
+
+    std::vector<cv::Mat> pages = PageSplitter::read_pages(path);
+    for (size_t page = 0; page < pages.size(); page++) {
+      auto regions = PageSplitter::find_forms(pages[page]);
+      for (size_t form = 0; form < regions.size(); form++) {
+        forms.push_back({pages[page](regions[form]), static_cast<int>(page),
+                         static_cast<int>(form)});
+      }
+    }
+    const double split_ms = std::chrono::duration<double, std::milli>(
+                                std::chrono::high_resolution_clock::now() -
+                                start_time)
+                                .count();
+
+    if (forms.empty()) {
+      ScanResult failed;
+      failed.schema = scanners.front()->get_options().schema;
+      failed.success = false;
+      failed.error_message = "Не удалось загрузить изображение: " + path;
+      failed.processing_time_ms = split_ms;
+      failed.source = path;
+      record_metrics(failed);
+      out.push_back(std::move(failed));
+      return;
+    }
+
+    out.resize(forms.size());
+    pending.add(forms.size());
+    for (size_t k = 0; k < forms.size(); k++) {
+      enqueue([this, &out, &pending, &path, split_ms, k,
+               form = std::move(forms[k])](size_t worker) {
+        ScanResult &result = out[k];
+        result = scanners[worker]->scan_mat(form.image);
+        result.timings.insert(result.timings.begin(),
+                              {"read_pages", split_ms});
+        result.source = path;
+        result.page_index = form.page;
+        result.form_index = form.form;
+        pending.done();
+      });
+    }
+  }
+
+  bool take(bool taken) {
+    if (taken) {
+      outstanding--;
+    }
+    return taken;
+  }
+};
+
+// Загрузка папки, в которую продолжают поступать сканы: изображения,
+// которые уже лежат в папке, и новые по мере появления (FolderWatcher)
+// распознаются пулом пакетами по batch_size и пакетом же дописываются в
+// журнал результатов. Журнал загрузки (IngestJournal) хранит хеши
+// содержимого записанных файлов, поэтому перезапуск или переименованная
+// копия не дают повторных строк. Если процесс упал между OCR и записью,
+// файлы пакета распознаются снова, но результат берётся из кэша
+// результатов сканера (ключ кэша — тот же хеш содержимого); строки,
+// дописанные до сбоя, журнал загрузки при открытии отрезает.
+//
+// Загруженными считаются только распознанные файлы: файл с ошибкой
+// распознаётся снова при следующей встрече, а файл, который не удалось
+// прочитать, — на следующих шагах, до max_read_attempts раз.
+//
+// Ячейки строки задаются ключами столбцов:
+//   @time     — время записи, "дд.мм.гггг чч:мм"
+//   @file     — имя файла; @path — полный путь; @hash — хеш содержимого
+//   @status   — "Успешно" или "Ошибка: <первые 50 символов>"
+//   @time_ms  — время обработки, мс; @raw_text — начало текста (500
+//               символов)
+//   =текст    — текст как есть (оператор, комментарий)
+//   иначе     — ответ поля схемы с этим ключом.
+// У строки с ошибкой ответы, время и текст пустые.
+class FolderIngest {
+public:
+  struct Stats {
+    int64_t committed = 0;  // строк записано за шаг
+    int64_t succeeded = 0;  // из них распознано успешно
+    int64_t failed = 0;     // файлы с ошибкой: не прочитались или не
+                            // распознались
+    int64_t skipped = 0;    // уже загруженные и повторы
+    int64_t cache_hits = 0; // результат взят из кэша, без OCR
+    size_t pending = 0;     // найдено, но ещё не загружено
+    size_t retrying = 0;    // не прочитались, будут прочитаны снова
+    size_t settling = 0;    // появились, но ещё пишутся (FolderWatcher)
+    bool watching = true;   // false — наблюдение за папкой прервалось
+  };
+
+  // Попыток прочитать файл, прежде чем отказаться от него до следующего
+  // события или перезапуска
+  static constexpr int max_read_attempts = 5;
+  // Пауза перед повторным чтением, мс
+  static constexpr int retry_ms = 1000;
+
+  FolderIngest(ScannerPool &pool, ResultSink &sink, const std::string &folder,
+               const std::string &journal_path,
+               const std::vector<std::string> &column_keys, size_t batch_size)
+      : pool(pool), sink(sink), watcher(folder),
+        journal(journal_path, sink.rows(),
+                [&sink](int64_t rows) { return sink.truncate(rows); }),
+        columns(compile(column_keys, *pool.schema())),
+        batch_size(std::max<size_t>(1, batch_size)) {
+    // Папка читается после того, как наблюдение запущено: файл, который
+    // появится между ними, придёт и событием, и в списке
+    if (watcher.is_open()) {
+      enqueue(watcher.list());
+    }
+  }
+
+  bool is_ready() const {
+    return watcher.is_open() && journal.is_open() &&
+           columns.size() == sink.column_count();
+  }
+
+  // Загружает один пакет. Если загружать нечего, сначала ждёт новые файлы
+  // до timeout_ms (< 0 — без ограничения, но не дольше retry_ms, если
+  // есть файлы для повторного чтения).
+  Stats step(int timeout_ms) {
+    Stats stats;
+    if (queue.empty()) {
+      int wait_ms = timeout_ms;
+      if (!retry.empty()) {
+        wait_ms = timeout_ms < 0 ? retry_ms : std::min(timeout_ms, retry_ms);
+      }
+      std::vector<std::string> found;
+      stats.watching = watcher.wait(found, wait_ms);
+      enqueue(found);
+    }
+    enqueue(retry);
+    retry.clear();
+
+    // Файлы пакета; copy_of — индекс файла пакета с тем же содержимым
+    std::vector<IngestJournal::Entry> entries;
+    std::vector<size_t> copy_of;
+    std::vector<std::string> paths; // к распознаванию
+    std::vector<size_t> scanned;    // их индексы в entries
+    std::unordered_map<uint64_t, size_t> batch_hashes;
+    while (!queue.empty() && paths.size() < batch_size) {
+      IngestJournal::Entry entry;
+      entry.path = std::move(queue.front());
+      queue.pop_front();
+      queued.erase(entry.path);
+
+      const auto state = FolderWatcher::file_state(entry.path);
+      if (state.size < 0) {
+        read_attempts.erase(entry.path);
+        continue; // файл удалили, пока он ждал очереди
+      }
+      entry.size = state.size;
+      entry.mtime = state.mtime;
+      if (journal.seen(entry.path, entry.size, entry.mtime)) {
+        stats.skipped++;
+        continue;
+      }
+      if (!hash::read_file(entry.path, bytes)) {
+        stats.failed++;
+        defer(entry.path);
+        continue;
+      }
+      read_attempts.erase(entry.path);
+      entry.hash = hash::xxh64(bytes.data(), bytes.size());
+
+      const size_t index = entries.size();
+      auto copy = batch_hashes.emplace(entry.hash, index);
+      if (journal.contains(entry.hash) || !copy.second) {
+        // Копия уже загруженного снимка: строки нет, но путь попадёт в
+        // журнал, чтобы не читать файл снова
+        stats.skipped++;
+      } else {
+        paths.push_back(entry.path);
+        scanned.push_back(index);
+      }
+      copy_of.push_back(copy.first->second);
+      entries.push_back(std::move(entry));
+    }
+    stats.pending = queue.size();
+    stats.retrying = retry.size();
+    stats.settling = watcher.settling();
+    if (entries.empty()) {
+      return stats;
+    }
+
+    std::vector<ScanResult> results = pool.scan_batch(paths);
+    std::vector<std::string> cells;
+    cells.reserve(results.size() * columns.size());
+    int64_t rows = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+      IngestJournal::Entry &entry = entries[scanned[i]];
+      entry.failed = !results[i].success;
+      stats.cache_hits += results[i].cache_hit ? 1 : 0;
+      if (!entry.failed) {
+        stats.succeeded++;
+      } else {
+        stats.failed++;
+        if (journal.failed_before(entry.hash)) {
+          continue; // строка с этой ошибкой уже есть
+        }
+      }
+      append_row(cells, results[i], entry.path, entry.hash);
+      rows++;
+    }
+    // Копия внутри пакета разделяет судьбу своего оригинала: копия
+    // нераспознанного снимка не должна помечать содержимое загруженным
+    for (size_t i = 0; i < entries.size(); i++) {
+      entries[i].failed = entries[copy_of[i]].failed;
+    }
+
+    const int64_t rows_before = sink.rows();
+    if (!journal.record(entries, rows_before, rows_before + rows,
+                        [&] { return sink.append(cells); })) {
+      throw std::runtime_error("Не удалось записать пакет в журнал");
+    }
+    stats.committed = rows;
+    return stats;
+  }
+
+private:
+  enum class Source { Literal, Time, File, Path, Hash, Status, TimeMs,
+                      RawText, Answer };
+
+  // Ключ столбца, разобранный один раз при открытии
+  struct Column {
+    Source source = Source::Answer;
+    std::string text; // для Literal
+    int slot = -1;    // для Answer; -1 — поля нет в схеме
+  };
+
+  ScannerPool &pool;
+  ResultSink &sink;
+  FolderWatcher watcher;
+  IngestJournal journal;
+  std::vector<Column> columns;
+  size_t batch_size;
+  std::deque<std::string> queue;
+  std::unordered_set<std::string> queued;
+  std::vector<uint8_t> bytes; // содержимое файла для хеша
+  // Файлы, которые не прочитались: в очередь на следующем шаге
+  std::vector<std::string> retry;
+  std::unordered_map<std::string, int> read_attempts;
+
+  void defer(const std::string &path) {
+    if (++read_attempts[path] < max_read_attempts) {
+      retry.push_back(path);
+      return;
+    }
+    read_attempts.erase(path);
+    std::cerr << "Не удалось прочитать " << path << " за "
+              << max_read_attempts << " попыток" << std::endl;
+  }
+
+  void enqueue(const std::vector<std::string> &paths) {
+    for (const auto &path : paths) {
+      if (queued.insert(path).second) {
+        queue.push_back(path);
+      }
+    }
+  }
+
+  // Первые max_chars символов UTF-8 строки
+  static std::string utf8_prefix(const std::string &text, size_t max_chars,
+                                 const char *ellipsis = "") {
+    size_t chars = 0;
+    for (size_t i = 0; i < text.size(); i++) {
+      if ((static_cast<unsigned char>(text[i]) & 0xC0) != 0x80 &&
+          chars++ == max_chars) {
+        return text.substr(0, i) + ellipsis;
+      }
+    }
+    return text;
+  }
+
+  static std::string local_time() {
+    std::time_t now = std::time(nullptr);
+    std::tm tm{};
+#ifdef _WIN32
+    localtime_s(&tm, &now);
+#else
+    localtime_r(&now, &tm);
+#endif
+    char text[32];
+    std::strftime(text, sizeof(text), "%d.%m.%Y %H:%M", &tm);
+    return text;
+  }
+
+  static std::vector<Column> compile(const std::vector<std::string> &keys,
+                                     const FormSchema &schema) {
+    static const std::map<std::string, Source> specials = {
+        {"@time", Source::Time},       {"@file", Source::File},
+        {"@path", Source::Path},       {"@hash", Source::Hash},
+        {"@status", Source::Status},   {"@time_ms", Source::TimeMs},
+        {"@raw_text", Source::RawText}};
+    std::vector<Column> columns;
+    for (const auto &key : keys) {
+      Column column;
+      auto it = specials.find(key);
+      if (!key.empty() && key[0] == '=') {
+        column.source = Source::Literal;
+        column.text = key.substr(1);
+      } else if (it != specials.end()) {
+        column.source = it->second;
+      } else {
+        column.slot = schema.find(key);
+      }
+      columns.push_back(std::move(column));
+    }
+    return columns;
+  }
+
+  void append_row(std::vector<std::string> &cells, const ScanResult &result,
+                  const std::string &path, uint64_t content_hash) const {
+    char text[32];
+    for (const auto &column : columns) {
+      switch (column.source) {
+      case Source::Literal:
+        cells.push_back(column.text);
+        break;
+      case Source::Time:
+        cells.push_back(local_time());
+        break;
+      case Source::File:
+        cells.push_back(std::filesystem::u8path(path).filename().u8string());
+        break;
+      case Source::Path:
+        cells.push_back(path);
+        break;
+      case Source::Hash:
+        std::snprintf(text, sizeof(text), "%016llx",
+                      static_cast<unsigned long long>(content_hash));
+        cells.push_back(text);
+        break;
+      case Source::Status:
+        cells.push_back(result.success
+                            ? "Успешно"
+                            : "Ошибка: " + utf8_prefix(result.error_message,
+                                                       50));
+        break;
+      case Source::TimeMs:
+        std::snprintf(text, sizeof(text), "%.1f", result.processing_time_ms);
+        cells.push_back(result.success ? text : "");
+        break;
+      case Source::RawText:
+        cells.push_back(result.success
+                            ? utf8_prefix(result.raw_text, 500, "...")
+                            : "");
+        break;
+      case Source::Answer:
+        cells.push_back(
+            column.slot < 0 ? std::string()
+                            : answer_of(result,
+                                        static_cast<size_t>(column.slot)));
+        break;
+      }
+    }
+  }
+};
+
+// Конвейер пакетного сканирования: декодирование, предобработка и OCR
+// выполняются отдельными пулами потоков, связанными ограниченными
+// очередями. Пока OCR распознаёт изображение k, следующие уже читаются с
+// диска и проходят предобработку. Размер каждого пула задаётся отдельно:
+// OCR — узкое место, а декодирование упирается в ввод-вывод.
+class MUZLOTO_EXPORT ScanPipeline {
+public:
+  struct Config {
+    size_t decode_workers = 1;
+    size_t preprocess_workers = 1;
+    size_t ocr_workers = 0; // 0 — по числу ядер
+  };
+
+  ScanPipeline(const MuzlotoScanner &prototype, const Config &config)
+      : options(prototype.get_options()),
+        ocr_size(config.ocr_workers > 0
+                     ? config.ocr_workers
+                     : std::max(1u, std::thread::hardware_concurrency())),
+        decode_size(std::max<size_t>(1, config.decode_workers)),
+        preprocess_size(std::max<size_t>(1, config.preprocess_workers)),
+        paths(2 * decode_size), decoded(2 * preprocess_size),
+        prepared(2 * ocr_size),
+        spare_buffers(decode_size + 3 * preprocess_size + 3 * ocr_size),
+        failed_workers(0) {
+    scanners.resize(ocr_size);
+    for (auto &scanner : scanners) {
+      scanner = std::make_unique<MuzlotoScanner>();
+    }
+
+    // Движки OCR инициализируются параллельно, как в ScannerPool
+    const std::string tessdata_path = prototype.get_tessdata_path();
+    const int64_t resident_before = process_resident_bytes();
+    {
+      ModelCache::Scope models; // модели читаются с диска один раз
+      WaitGroup started(ocr_size);
+      ocr_pool = std::make_unique<ThreadPool>(
+          ocr_size, [this, &started, tessdata_path](size_t worker) {
+            if (!scanners[worker]->initialize(tessdata_path)) {
+              failed_workers++;
+            }
+            scanners[worker]->set_options(options);
+            started.done();
+          });
+      started.wait();
+    }
+    count_engines(scanners, process_resident_bytes() - resident_before);
+
+    decode_pool = std::make_unique<ThreadPool>(decode_size);
+    preprocess_pool = std::make_unique<ThreadPool>(preprocess_size);
+
+    // Каждый поток этапа крутит свой цикл до закрытия входной очереди
+    for (size_t i = 0; i < decode_size; i++) {
+      decode_pool->submit([this](size_t) { decode_loop(); });
+    }
+    for (size_t i = 0; i < preprocess_size; i++) {
+      preprocess_pool->submit([this](size_t) { preprocess_loop(); });
+    }
+    for (size_t i = 0; i < ocr_size; i++) {
+      ocr_pool->submit([this](size_t worker) { ocr_loop(worker); });
+    }
+
+    // Очередь — всё, что ещё не дошло до OCR
+    Metrics::global().attach_pool(this, "pipeline", [this] {
+      return Metrics::PoolSample{
+          static_cast<int64_t>(ocr_size), ocr_load.busy,
+          static_cast<int64_t>(paths.size() + decoded.size() +
+                               prepared.size()),
+          ocr_load.busy_ns / 1e9};
+    });
+  }
+
+  ~ScanPipeline() {
+    Metrics::global().detach_pool(this);
+    // Очереди закрываются по порядку этапов: каждый этап дорабатывает
+    // то, что уже получил, и только потом останавливается следующий
+    paths.close();
+    decode_pool.reset();
+    decoded.close();
+    preprocess_pool.reset();
+    prepared.close();
+    ocr_pool.reset();
+  }
+
+  ScanPipeline(const ScanPipeline &) = delete;
+  ScanPipeline &operator=(const ScanPipeline &) = delete;
+
+  bool is_ready() const { return failed_workers == 0; }
+
+  // Результаты в порядке paths. Пакеты из разных потоков могут идти через
+  // конвейер одновременно.
+  std::vector<ScanResult> scan_batch(const std::vector<std::string> &batch) {
+    Batch state(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+      Item item;
+      item.batch = &state;
+      item.index = i;
+      item.path = batch[i];
+      item.result.schema = options.schema;
+      paths.push(std::move(item));
+    }
+
+    state.pending.wait();
+    return std::move(state.results);
+  }
+
+private:
+  using Clock = std::chrono::high_resolution_clock;
+
+  struct Batch {
+    explicit Batch(size_t size) : results(size), pending(size) {}
+
+    std::vector<ScanResult> results;
+    WaitGroup pending;
+  };
+
+  // Изображение в пути по конвейеру. Буферы предобработки едут вместе с
+  // ним: результат этапа должен дожить до OCR в другом потоке. Набор
+  // буферов берётся при декодировании и после OCR возвращается в
+  // spare_buffers для следующего изображения.
+  struct Item {
+    Batch *batch = nullptr;
+    size_t index = 0;
+    std::string path;
+    Clock::time_point start;
+    cv::Mat image;
+    std::unique_ptr<WorkBuffers> buffers;
+    cv::Mat processed; // заголовок над buffers.binary
+    ScanResult result;
+  };
+
+  void decode_loop() {
+    Item item;
+    while (paths.pop(item)) {
+      item.start = Clock::now();
+      if (!spare_buffers.try_pop(item.buffers)) {
+        item.buffers = std::make_unique<WorkBuffers>();
+      }
+      if (run_stage(item, [&] {
+            StageTimer timer(item.result.timings);
+            item.image = load_image(item.path);
+            timer.lap("imread");
+            item.result.image_width = item.image.cols;
+            item.result.image_height = item.image.rows;
+          })) {
+        decoded.push(std::move(item));
+      }
+    }
+  }
+
+  void preprocess_loop() {
+    Item item;
+    while (decoded.pop(item)) {
+      if (run_stage(item, [&] {
+            item.processed =
+                prepare_page(item.image, options, *item.buffers, item.result);
+          })) {
+        prepared.push(std::move(item));
+      }
+    }
+  }
+
+  void ocr_loop(size_t worker) {
+    Item item;
+    while (prepared.pop(item)) {
+      BusyScope busy(ocr_load, false);
+      if (run_stage(item, [&] {
+            MuzlotoScanner &scanner = *scanners[worker];
+            scanner.recognize_page(item.processed, item.result);
+            scanner.refine_weak_fields(
+                options.align_page ? item.buffers->page : item.image,
+                item.result);
+          })) {
+        item.result.success = true;
+        finish(item);
+      }
+    }
+  }
+
+  // Выполняет этап; при ошибке результат сразу отдаётся с сообщением, и
+  // изображение дальше по конвейеру не идёт
+  template <typename StageFn> bool run_stage(Item &item, StageFn stage) {
+    try {
+      stage();
+      return true;
+    } catch (const std::exception &e) {
+      item.result.success = false;
+      item.result.error_message = e.what();
+      finish(item);
+      return false;
+    }
+  }
+
+  void finish(Item &item) {
+    item.result.processing_time_ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - item.start)
+            .count();
+    record_metrics(item.result);
+    item.processed.release();
+    item.image.release();
+    if (item.buffers) {
+      // Все наборы буферов — у изображений в пути, поэтому свободных не
+      // больше ёмкости очереди и push не ждёт
+      spare_buffers.push(std::move(item.buffers));
+    }
+    Batch *batch = item.batch;
+    batch->results[item.index] = std::move(item.result);
+    batch->pending.done();
+  }
+
+  const ScannerOptions options;
+  const size_t ocr_size;
+  const size_t decode_size;
+  const size_t preprocess_size;
+
+  std::vector<std::unique_ptr<MuzlotoScanner>> scanners;
+  BoundedQueue<Item> paths;
+  BoundedQueue<Item> decoded;
+  BoundedQueue<Item> prepared;
+  // Свободные наборы буферов; ёмкость — сколько изображений может быть
+  // в пути от декодирования до OCR (потоки этапов и очереди между ними)
+  BoundedQueue<std::unique_ptr<WorkBuffers>> spare_buffers;
+  std::unique_ptr<ThreadPool> ocr_pool;
+  std::unique_ptr<ThreadPool> decode_pool;
+  std::unique_ptr<ThreadPool> preprocess_pool;
+  std::atomic<size_t> failed_workers;
+  WorkerLoad ocr_load; // для метрик: занятость потоков OCR
+};
+
+// Ответ поля slot; у результата с ошибкой до разбора ответов нет
+inline const std::string &answer_of(const ScanResult &result, size_t slot) {
+  static const std::string empty;
+  return slot < result.answers.size() ? result.answers[slot] : empty;
+}
+
+// Конвертирует результат сканирования в JSON для C-интерфейса
+json result_to_json(const ScanResult &result) {
+  auto start_time = std::chrono::high_resolution_clock::now();
+  json j;
+  j["success"] = result.success;
+  j["error_message"] = result.error_message;
+  j["error_code"] = result.error_code;
+  j["processing_time_ms"] = result.processing_time_ms;
+  j["cache_hit"] = result.cache_hit;
+  if (!result.source.empty()) {
+    j["source"] = result.source;
+  }
+  j["page"] = result.page_index;
+  j["form"] = result.form_index;
+
+  j["counters"] = {{"image_width", result.image_width},
+                   {"image_height", result.image_height},
+                   {"ocr_chars", result.ocr_chars},
+                   {"refined_fields", result.refined_fields},
+                   {"text_height_px", result.text_height},
+                   {"ocr_scale", result.ocr_scale},
+                   {"source_ppi", result.source_ppi}};
+
+  if (result.quality.checked) {
+    j["quality"] = {{"reason", result.quality.reason},
+                    {"sharpness", result.quality.sharpness},
+                    {"ink_density", result.quality.ink_density},
+                    {"text_lines", result.quality.text_lines}};
+  }
+
+  if (!result.homography.empty()) {
+    j["alignment"] = {{"page_found", result.page_found},
+                      {"homography", result.homography}};
+  }
+
+  // === Поля анкеты по схеме ===
+  const std::vector<SchemaField> &schema_fields = result.schema->fields();
+  for (size_t slot = 0; slot < schema_fields.size(); slot++) {
+    j[schema_fields[slot].id] = answer_of(result, slot);
+  }
+
+  j["raw_text"] = result.raw_text.substr(0, 500);
+
+  // Все распознанные поля
+  json fields_array = json::array();
+  for (const auto &field : result.fields) {
+    json f;
+    f["name"] = field.name;
+    f["value"] = field.value;
+    f["confidence"] = field.confidence;
+    f["slot"] = field.slot;
+    if (!field.box.empty()) {
+      f["box"] = {field.box.x, field.box.y, field.box.width,
+                  field.box.height};
+    }
+    fields_array.push_back(f);
+  }
+  j["fields"] = fields_array;
+
+  // Длительности этапов, мс; serialize — сборка этого JSON (без dump)
+  json timings = json::object();
+  for (const auto &[stage, ms] : result.timings) {
+    timings[stage] = ms;
+  }
+  timings["serialize"] = std::chrono::duration<double, std::milli>(
+                             std::chrono::high_resolution_clock::now() -
+                             start_time)
+                             .count();
+  j["timings"] = timings;
+
+  return j;
+}
+
+// Обратное преобразование для ResultCache. Длительности этапов не
+// восстанавливаются — они относятся к давнему скану. Поля читаются по
+// схеме, с которой записан результат (она входит в ключ кэша).
+ScanResult result_from_json(const json &j,
+                            std::shared_ptr<const FormSchema> schema) {
+  ScanResult result;
+  result.schema = std::move(schema);
+  result.success = j.at("success").get<bool>();
+  result.error_message = j.value("error_message", "");
+  result.error_code = j.value("error_code", "");
+  result.processing_time_ms = j.value("processing_time_ms", 0.0);
+  result.raw_text = j.value("raw_text", "");
+  result.source = j.value("source", "");
+  result.page_index = j.value("page", 0);
+  result.form_index = j.value("form", 0);
+
+  if (j.contains("counters")) {
+    const json &counters = j["counters"];
+    result.image_width = counters.value("image_width", 0);
+    result.image_height = counters.value("image_height", 0);
+    result.ocr_chars = counters.value("ocr_chars", size_t{0});
+    result.refined_fields = counters.value("refined_fields", 0);
+    result.text_height = counters.value("text_height_px", 0.0);
+    result.ocr_scale = counters.value("ocr_scale", 1.0);
+    result.source_ppi = counters.value("source_ppi", 0);
+  }
+  if (j.contains("quality")) {
+    const json &quality = j["quality"];
+    result.quality.checked = true;
+    result.quality.reason = quality.value("reason", "");
+    result.quality.sharpness = quality.value("sharpness", 0.0);
+    result.quality.ink_density = quality.value("ink_density", 0.0);
+    result.quality.text_lines = quality.value("text_lines", 0);
+  }
+  if (j.contains("alignment")) {
+    result.page_found = j["alignment"].value("page_found", false);
+    result.homography =
+        j["alignment"].value("homography", std::vector<double>());
+  }
+
+  for (const auto &field : result.schema->fields()) {
+    result.answers.push_back(j.value(field.id, ""));
+  }
+  for (const auto &f : j.value("fields", json::array())) {
+    cv::Rect box;
+    std::vector<int> b = f.value("box", std::vector<int>());
+    if (b.size() == 4) {
+      box = cv::Rect(b[0], b[1], b[2], b[3]);
+    }
+    result.fields.push_back({f.value("name", ""), f.value("value", ""),
+                             f.value("confidence", 0.0f), f.value("slot", -1),
+                             box});
+  }
+  return result;
+}
+
+json error_to_json(const std::string &message) {
+  json error_json;
+  error_json["success"] = false;
+  error_json["error_message"] = message;
+  error_json["processing_time_ms"] = 0.0;
+  return error_json;
+}
+
+// Копия строки в malloc-буфер; освобождается через muzloto_free_string
+char *to_c_string(const std::string &str) {
+  char *c_str = static_cast<char *>(malloc(str.length() + 1));
+  if (c_str) {
+    std::strcpy(c_str, str.c_str());
+  }
+  return c_str;
+}
+
+// Упаковка результатов в MuzlotoResult: массив структур, за ним поля
+// всех результатов и арена со всеми строками, один malloc на весь пакет
+MuzlotoResult *to_c_results(const std::vector<ScanResult> &results,
+                            const std::vector<std::string> &sources) {
+  const size_t count = std::max<size_t>(results.size(), 1);
+  size_t field_count = 0;
+  size_t arena_size = 0;
+  auto reserve = [&arena_size](const std::string &str) {
+    arena_size += str.size() + 1;
+  };
+  for (size_t i = 0; i < results.size(); i++) {
+    const ScanResult &result = results[i];
+    reserve(result.error_message);
+    reserve(result.error_code);
+    reserve(i < sources.size() ? sources[i] : std::string());
+    reserve(result.raw_text);
+    const std::vector<SchemaField> &schema_fields = result.schema->fields();
+    field_count += schema_fields.size();
+    for (size_t slot = 0; slot < schema_fields.size(); slot++) {
+      reserve(schema_fields[slot].id);
+      reserve(answer_of(result, slot));
+    }
+  }
+
+  const size_t header_size = count * sizeof(MuzlotoResult);
+  const size_t fields_size = field_count * sizeof(MuzlotoField);
+  char *block = static_cast<char *>(
+      calloc(1, header_size + fields_size + arena_size));
+  if (!block) {
+    return nullptr;
+  }
+  auto *c_results = reinterpret_cast<MuzlotoResult *>(block);
+  auto *c_fields = reinterpret_cast<MuzlotoField *>(block + header_size);
+  char *arena = block + header_size + fields_size;
+  auto place = [&arena](const std::string &str) {
+    std::memcpy(arena, str.data(), str.size());
+    arena[str.size()] = '\0';
+    MuzlotoString view{arena, str.size()};
+    arena += str.size() + 1;
+    return view;
+  };
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const ScanResult &result = results[i];
+    MuzlotoResult &c = c_results[i];
+    c.success = result.success ? 1 : 0;
+    c.cache_hit = result.cache_hit ? 1 : 0;
+    c.processing_time_ms = result.processing_time_ms;
+    c.image_width = result.image_width;
+    c.image_height = result.image_height;
+    c.page = result.page_index;
+    c.form = result.form_index;
+    c.error_message = place(result.error_message);
+    c.error_code = place(result.error_code);
+    c.source = place(i < sources.size() ? sources[i] : std::string());
+    c.raw_text = place(result.raw_text);
+
+    const std::vector<SchemaField> &schema_fields = result.schema->fields();
+    c.field_count = static_cast<int>(schema_fields.size());
+    c.fields = c_fields;
+    c_fields += schema_fields.size();
+    for (size_t slot = 0; slot < schema_fields.size(); slot++) {
+      c.fields[slot].id = place(schema_fields[slot].id);
+      c.fields[slot].value = place(answer_of(result, slot));
+    }
+    for (const auto &field : result.fields) {
+      if (field.slot >= 0 && field.slot < c.field_count) {
+        float &confidence = c.fields[field.slot].confidence;
+        confidence = std::max(confidence, field.confidence);
+      }
+    }
+  }
+  return c_results;
+}
+
+// Сканирует и возвращает JSON; строка освобождается muzloto_free_string
+template <typename ScanFn> const char *scan_to_c_string(ScanFn scan) {
+  try {
+    // Конвертируем результат в JSON
+    return to_c_string(result_to_json(scan()).dump());
+
+  } catch (const std::exception &e) {
+    return to_c_string(
+        error_to_json(std::string("C++ exception: ") + e.what()).dump());
+  }
+}
+
+} // namespace muzloto
+
+// C-интерфейс для простого использования
+extern "C" {
+MUZLOTO_EXPORT void *muzloto_create() { return new muzloto::MuzlotoScanner(); }
+
+// Дескриптор, который можно вызывать из нескольких потоков сразу: на
+// время скана он берёт один из n_engines движков (<= 0 — по числу ядер)
+MUZLOTO_EXPORT void *muzloto_create_pooled(int n_engines) {
+  const size_t engines =
+      n_engines > 0 ? static_cast<size_t>(n_engines)
+                    : std::max(1u, std::thread::hardware_concurrency());
+  return new muzloto::MuzlotoScanner(engines);
+}
+
+MUZLOTO_EXPORT void muzloto_set_lease_timeout(void *scanner, int timeout_ms) {
+  static_cast<muzloto::MuzlotoScanner *>(scanner)->set_lease_timeout(
+      timeout_ms);
+}
+
+MUZLOTO_EXPORT void muzloto_destroy(void *scanner) {
+  delete static_cast<muzloto::MuzlotoScanner *>(scanner);
 }
 
 MUZLOTO_EXPORT int muzloto_initialize(void *scanner,
                                       const char *tessdata_path) {
-  return static_cast<muzloto::MuzlotoScanner *>(scanner)->initialize(
-             tessdata_path ? std::string(tessdata_path) : "")
-             ? 1
-             : 0;
+  auto *instance = static_cast<muzloto::MuzlotoScanner *>(scanner);
+  const int64_t resident_before = muzloto::process_resident_bytes();
+  if (!instance->initialize(tessdata_path ? std::string(tessdata_path)
+                                          : "")) {
+    return 0;
+  }
+  // Движки общего дескриптора учтены при инициализации
+  if (!instance->is_shared()) {
+    instance->count_engine(muzloto::process_resident_bytes() -
+                           resident_before);
+  }
+  return 1;
 }
 
 MUZLOTO_EXPORT const char *muzloto_scan_image(void *scanner,
                                               const char *image_path) {
-  try {
-    auto result = static_cast<muzloto::MuzlotoScanner *>(scanner)->scan_image(
+  return muzloto::scan_to_c_string([&] {
+    return static_cast<muzloto::MuzlotoScanner *>(scanner)->scan_image(
         image_path ? std::string(image_path) : "");
+  });
+}
 
-    // Конвертируем результат в JSON
-    nlohmann::json j;
-    j["success"] = result.success;
-    j["error_message"] = result.error_message;
-    j["processing_time_ms"] = result.processing_time_ms;
-
-    // === Поля анкеты Muzloto (16 полей) ===
-    j["date"] = result.date;
-    j["table_number"] = result.table_number;
-    j["location"] = result.location;
-    j["satisfaction_rating"] = result.satisfaction_rating;
-    j["playlist_rating"] = result.playlist_rating;
-    j["tracks_to_add"] = result.tracks_to_add;
-    j["location_rating"] = result.location_rating;
-    j["kitchen_rating"] = result.kitchen_rating;
-    j["service_rating"] = result.service_rating;
-    j["host_rating"] = result.host_rating;
-    j["visits_count"] = result.visits_count;
-    j["ticket_price"] = result.ticket_price;
-    j["know_booking"] = result.know_booking;
-    j["source_info"] = result.source_info;
-    j["purpose"] = result.purpose;
-    j["improvements"] = result.improvements;
-    j["phone_number"] = result.phone_number;
-
-    j["raw_text"] = result.raw_text.substr(0, 500);
-
-    // Все распознанные поля
-    nlohmann::json fields_array = nlohmann::json::array();
-    for (const auto &field : result.fields) {
-      nlohmann::json f;
-      f["name"] = field.name;
-      f["value"] = field.value;
-      f["confidence"] = field.confidence;
-      fields_array.push_back(f);
+// Сканирование закодированного изображения (JPEG, PNG...) из памяти
+MUZLOTO_EXPORT const char *muzloto_scan_buffer(void *scanner,
+                                               const uint8_t *data,
+                                               size_t len) {
+  return muzloto::scan_to_c_string([&] {
+    return static_cast<muzloto::MuzlotoScanner *>(scanner)->scan_encoded(data,
+                                                                         len);
+  });
+}
+
+// Сканирование декодированных пикселей (1 — серый, 3 — BGR, 4 — BGRA);
+// stride — число байт в строке изображения
+MUZLOTO_EXPORT const char *muzloto_scan_pixels(void *scanner,
+                                               const uint8_t *pixels, int width,
+                                               int height, int channels,
+                                               size_t stride) {
+  return muzloto::scan_to_c_string([&] {
+    return static_cast<muzloto::MuzlotoScanner *>(scanner)->scan_pixels(
+        pixels, width, height, channels, stride);
+  });
+}
+
+// Схема анкеты (JSON с вопросами, ключами и типами полей). NULL или пустая
+// строка возвращают встроенную схему muzloto_v1. Возвращает 0 при ошибке в
+// схеме или если полей загруженного шаблона в ней нет.
+MUZLOTO_EXPORT int muzloto_load_schema(void *scanner, const char *schema_path) {
+  return static_cast<muzloto::MuzlotoScanner *>(scanner)->load_schema(
+             schema_path ? std::string(schema_path) : "")
+             ? 1
+             : 0;
+}
+
+// Шаблон анкеты (JSON с нормированными областями ответов). NULL или пустая
+// строка возвращают области схемы (без них — распознавание всей
+// страницы). Возвращает 0 при ошибке в шаблоне.
+MUZLOTO_EXPORT int muzloto_load_template(void *scanner,
+                                         const char *template_path) {
+  return static_cast<muzloto::MuzlotoScanner *>(scanner)->load_form_template(
+             template_path ? std::string(template_path) : "")
+             ? 1
+             : 0;
+}
+
+// Выравнивание страницы перед распознаванием. page_width/page_height <= 0 —
+// размер страницы из шаблона или 1240x1860.
+MUZLOTO_EXPORT void muzloto_set_alignment(void *scanner, int enabled,
+                                          int page_width, int page_height) {
+  static_cast<muzloto::MuzlotoScanner *>(scanner)->set_page_alignment(
+      enabled != 0, page_width, page_height);
+}
+
+// Дисковый кэш результатов по содержимому изображения, до max_bytes байт.
+// NULL или пустой каталог отключают кэш. Возвращает 0, если каталог не
+// удалось открыть.
+MUZLOTO_EXPORT int muzloto_set_result_cache(void *scanner,
+                                            const char *directory,
+                                            size_t max_bytes) {
+  return static_cast<muzloto::MuzlotoScanner *>(scanner)->set_result_cache(
+             directory ? std::string(directory) : "", max_bytes)
+             ? 1
+             : 0;
+}
+
+MUZLOTO_EXPORT void muzloto_clear_result_cache(void *scanner) {
+  auto *s = static_cast<muzloto::MuzlotoScanner *>(scanner);
+  if (const auto &cache = s->get_options().result_cache) {
+    cache->clear();
+  }
+}
+
+// Целевая высота символа (пиксели), до которой снимок уменьшается перед
+// OCR; 0 отключает нормализацию разрешения
+MUZLOTO_EXPORT void muzloto_set_text_height(void *scanner, int pixels) {
+  static_cast<muzloto::MuzlotoScanner *>(scanner)->set_target_text_height(
+      pixels);
+}
+
+// Профиль предобработки: "quality" (по умолчанию) или "fast".
+// Возвращает 0 для неизвестного профиля.
+MUZLOTO_EXPORT int muzloto_set_preprocess_profile(void *scanner,
+                                                  const char *profile) {
+  muzloto::PreprocessProfile parsed;
+  if (!profile || !muzloto::parse_preprocess_profile(profile, parsed)) {
+    return 0;
+  }
+  static_cast<muzloto::MuzlotoScanner *>(scanner)->set_preprocess_profile(
+      parsed);
+  return 1;
+}
+
+// Устройство предобработки: "cpu" (по умолчанию), "opencl", "cuda" или
+// "auto". Недоступный на машине ускоритель заменяется на CPU — выбранное
+// возвращает muzloto_preprocess_backend(). Возвращает 0 для неизвестного
+// имени.
+MUZLOTO_EXPORT int muzloto_set_preprocess_backend(void *scanner,
+                                                  const char *backend) {
+  muzloto::PreprocessBackend parsed;
+  if (!backend || !muzloto::resolve_preprocess_backend(backend, parsed)) {
+    return 0;
+  }
+  static_cast<muzloto::MuzlotoScanner *>(scanner)->set_preprocess_backend(
+      parsed);
+  return 1;
+}
+
+// Выбранное устройство предобработки: "cpu", "opencl" или "cuda"
+MUZLOTO_EXPORT const char *muzloto_preprocess_backend(void *scanner) {
+  return muzloto::backend_name(
+      static_cast<muzloto::MuzlotoScanner *>(scanner)->preprocess_backend());
+}
+
+// Проверка снимка перед OCR: "off" (по умолчанию), "flag" — только
+// оценка в "quality", "reject" — непригодные снимки не распознаются.
+// Возвращает 0 для неизвестного режима.
+MUZLOTO_EXPORT int muzloto_set_quality_gate(void *scanner, const char *mode) {
+  muzloto::QualityGateMode parsed;
+  if (!mode || !muzloto::parse_quality_gate_mode(mode, parsed)) {
+    return 0;
+  }
+  static_cast<muzloto::MuzlotoScanner *>(scanner)->set_quality_gate(parsed);
+  return 1;
+}
+
+// Двухпроходный режим: enabled = 1 включает быстрый первый проход и
+// повторное распознавание слабых полей. fast_tessdata_path — каталог
+// быстрых моделей (tessdata_fast) для первого прохода; NULL — основные.
+MUZLOTO_EXPORT void muzloto_set_two_pass(void *scanner, int enabled,
+                                         const char *fast_tessdata_path) {
+  static_cast<muzloto::MuzlotoScanner *>(scanner)->set_two_pass(
+      enabled != 0, fast_tessdata_path ? fast_tessdata_path : "");
+}
+
+// Пул из n_workers сканеров с настройками scanner (n_workers <= 0 — по
+// числу ядер). Возвращает NULL, если хотя бы один движок не инициализирован.
+MUZLOTO_EXPORT void *muzloto_pool_create(void *scanner, int n_workers) {
+  try {
+    auto pool = std::make_unique<muzloto::ScannerPool>(
+        *static_cast<muzloto::MuzlotoScanner *>(scanner),
+        n_workers > 0 ? static_cast<size_t>(n_workers) : 0);
+    if (!pool->is_ready()) {
+      return nullptr;
+    }
+    return pool.release();
+  } catch (const std::exception &e) {
+    std::cerr << "Ошибка создания пула: " << e.what() << std::endl;
+    return nullptr;
+  }
+}
+
+MUZLOTO_EXPORT void muzloto_pool_destroy(void *pool) {
+  delete static_cast<muzloto::ScannerPool *>(pool);
+}
+
+// Пакетное сканирование: JSON-массив результатов в порядке image_paths
+MUZLOTO_EXPORT const char *muzloto_scan_batch(void *pool,
+                                              const char **image_paths,
+                                              int count) {
+  try {
+    std::vector<std::string> paths;
+    paths.reserve(count > 0 ? count : 0);
+    for (int i = 0; i < count; i++) {
+      paths.emplace_back(image_paths[i] ? image_paths[i] : "");
+    }
+
+    auto results = static_cast<muzloto::ScannerPool *>(pool)->scan_batch(paths);
+
+    nlohmann::json results_array = nlohmann::json::array();
+    for (const auto &result : results) {
+      results_array.push_back(muzloto::result_to_json(result));
+    }
+    return muzloto::to_c_string(results_array.dump());
+
+  } catch (const std::exception &e) {
+    return muzloto::to_c_string(
+        muzloto::error_to_json(std::string("C++ exception: ") + e.what())
+            .dump());
+  }
+}
+
+// === Асинхронное сканирование через пул ===
+
+MUZLOTO_EXPORT int muzloto_submit(void *pool, const char *image_path,
+                                  int64_t user_tag) {
+  try {
+    static_cast<muzloto::ScannerPool *>(pool)->submit(
+        image_path ? std::string(image_path) : "", user_tag);
+    return 1;
+  } catch (const std::exception &e) {
+    std::cerr << "Ошибка постановки в очередь: " << e.what() << std::endl;
+    return 0;
+  }
+}
+
+namespace {
+
+const char *completion_to_c_string(bool taken,
+                                   const muzloto::AsyncCompletion &completion,
+                                   int64_t *user_tag) {
+  if (!taken) {
+    return nullptr;
+  }
+  if (user_tag) {
+    *user_tag = completion.tag;
+  }
+  return muzloto::scan_to_c_string([&] { return completion.result; });
+}
+
+} // namespace
+
+MUZLOTO_EXPORT const char *muzloto_poll(void *pool, int64_t *user_tag) {
+  muzloto::AsyncCompletion completion;
+  bool taken = static_cast<muzloto::ScannerPool *>(pool)->poll(completion);
+  return completion_to_c_string(taken, completion, user_tag);
+}
+
+MUZLOTO_EXPORT const char *muzloto_wait(void *pool, int timeout_ms,
+                                        int64_t *user_tag) {
+  muzloto::AsyncCompletion completion;
+  bool taken =
+      static_cast<muzloto::ScannerPool *>(pool)->wait(completion, timeout_ms);
+  return completion_to_c_string(taken, completion, user_tag);
+}
+
+MUZLOTO_EXPORT int muzloto_pending(void *pool) {
+  return static_cast<int>(static_cast<muzloto::ScannerPool *>(pool)->pending());
+}
+
+// === Конвейер decode -> preprocess -> OCR ===
+
+MUZLOTO_EXPORT void *muzloto_pipeline_create(void *scanner, int decode_workers,
+                                             int preprocess_workers,
+                                             int ocr_workers) {
+  try {
+    muzloto::ScanPipeline::Config config;
+    config.decode_workers = decode_workers > 0 ? decode_workers : 1;
+    config.preprocess_workers = preprocess_workers > 0 ? preprocess_workers : 1;
+    config.ocr_workers = ocr_workers > 0 ? ocr_workers : 0;
+
+    auto pipeline = std::make_unique<muzloto::ScanPipeline>(
+        *static_cast<muzloto::MuzlotoScanner *>(scanner), config);
+    if (!pipeline->is_ready()) {
+      return nullptr;
+    }
+    return pipeline.release();
+  } catch (const std::exception &e) {
+    std::cerr << "Ошибка создания конвейера: " << e.what() << std::endl;
+    return nullptr;
+  }
+}
+
+MUZLOTO_EXPORT void muzloto_pipeline_destroy(void *pipeline) {
+  delete static_cast<muzloto::ScanPipeline *>(pipeline);
+}
+
+MUZLOTO_EXPORT const char *muzloto_pipeline_scan_batch(void *pipeline,
+                                                       const char **image_paths,
+                                                       int count) {
+  try {
+    std::vector<std::string> paths;
+    paths.reserve(count > 0 ? count : 0);
+    for (int i = 0; i < count; i++) {
+      paths.emplace_back(image_paths[i] ? image_paths[i] : "");
+    }
+
+    auto results =
+        static_cast<muzloto::ScanPipeline *>(pipeline)->scan_batch(paths);
+
+    nlohmann::json results_array = nlohmann::json::array();
+    for (const auto &result : results) {
+      results_array.push_back(muzloto::result_to_json(result));
+    }
+    return muzloto::to_c_string(results_array.dump());
+
+  } catch (const std::exception &e) {
+    return muzloto::to_c_string(
+        muzloto::error_to_json(std::string("C++ exception: ") + e.what())
+            .dump());
+  }
+}
+
+MUZLOTO_EXPORT MuzlotoResult *muzloto_scan_image_result(
+    void *scanner, const char *image_path) {
+  std::string path = image_path ? image_path : "";
+  std::vector<muzloto::ScanResult> results(1);
+  try {
+    results[0] =
+        static_cast<muzloto::MuzlotoScanner *>(scanner)->scan_image(path);
+  } catch (const std::exception &e) {
+    results[0].success = false;
+    results[0].error_message = std::string("C++ exception: ") + e.what();
+  }
+  return muzloto::to_c_results(results, {path});
+}
+
+MUZLOTO_EXPORT const char *muzloto_scan_documents(void *pool,
+                                                  const char **image_paths,
+                                                  int count) {
+  try {
+    std::vector<std::string> paths;
+    paths.reserve(count > 0 ? count : 0);
+    for (int i = 0; i < count; i++) {
+      paths.emplace_back(image_paths[i] ? image_paths[i] : "");
     }
-    j["fields"] = fields_array;
 
-    std::string json_str = j.dump();
-    char *c_str = static_cast<char *>(malloc(json_str.length() + 1));
-    if (c_str) {
-      std::strcpy(c_str, json_str.c_str());
+    auto results =
+        static_cast<muzloto::ScannerPool *>(pool)->scan_documents(paths);
+
+    nlohmann::json results_array = nlohmann::json::array();
+    for (const auto &result : results) {
+      results_array.push_back(muzloto::result_to_json(result));
     }
-    return c_str;
+    return muzloto::to_c_string(results_array.dump());
+
+  } catch (const std::exception &e) {
+    return muzloto::to_c_string(
+        muzloto::error_to_json(std::string("C++ exception: ") + e.what())
+            .dump());
+  }
+}
+
+MUZLOTO_EXPORT MuzlotoResult *muzloto_scan_documents_results(
+    void *pool, const char **image_paths, int count, int *result_count) {
+  std::vector<std::string> paths;
+  paths.reserve(count > 0 ? count : 0);
+  for (int i = 0; i < count; i++) {
+    paths.emplace_back(image_paths[i] ? image_paths[i] : "");
+  }
 
+  std::vector<muzloto::ScanResult> results;
+  try {
+    results = static_cast<muzloto::ScannerPool *>(pool)->scan_documents(paths);
   } catch (const std::exception &e) {
-    nlohmann::json error_json;
-    error_json["success"] = false;
-    error_json["error_message"] = std::string("C++ exception: ") + e.what();
-    error_json["processing_time_ms"] = 0.0;
+    results.assign(1, muzloto::ScanResult());
+    results[0].success = false;
+    results[0].error_message = std::string("C++ exception: ") + e.what();
+  }
+
+  std::vector<std::string> sources;
+  sources.reserve(results.size());
+  for (const auto &result : results) {
+    sources.push_back(result.source);
+  }
+  if (result_count) {
+    *result_count = static_cast<int>(results.size());
+  }
+  return muzloto::to_c_results(results, sources);
+}
+
+MUZLOTO_EXPORT MuzlotoResult *
+muzloto_scan_batch_results(void *pool, const char **image_paths, int count) {
+  std::vector<std::string> paths;
+  paths.reserve(count > 0 ? count : 0);
+  for (int i = 0; i < count; i++) {
+    paths.emplace_back(image_paths[i] ? image_paths[i] : "");
+  }
 
-    std::string error_str = error_json.dump();
-    char *error_c_str = static_cast<char *>(malloc(error_str.length() + 1));
-    if (error_c_str) {
-      std::strcpy(error_c_str, error_str.c_str());
+  std::vector<muzloto::ScanResult> results;
+  try {
+    results = static_cast<muzloto::ScannerPool *>(pool)->scan_batch(paths);
+  } catch (const std::exception &e) {
+    results.assign(paths.size(), muzloto::ScanResult());
+    for (auto &result : results) {
+      result.success = false;
+      result.error_message = std::string("C++ exception: ") + e.what();
     }
-    return error_c_str;
   }
+  return muzloto::to_c_results(results, paths);
+}
+
+MUZLOTO_EXPORT void *muzloto_sink_open(const char *path, const char **columns,
+                                       int column_count) {
+  if (!path || !columns || column_count <= 0) {
+    return nullptr;
+  }
+  std::vector<std::string> names;
+  for (int i = 0; i < column_count; i++) {
+    names.emplace_back(columns[i] ? columns[i] : "");
+  }
+
+  try {
+    auto sink = std::make_unique<muzloto::ResultSink>(path, std::move(names));
+    return sink->is_open() ? sink.release() : nullptr;
+  } catch (const std::exception &e) {
+    std::cerr << "Ошибка открытия журнала " << path << ": " << e.what()
+              << std::endl;
+    return nullptr;
+  }
+}
+
+MUZLOTO_EXPORT int muzloto_sink_append(void *sink, const char **cells,
+                                       int row_count) {
+  auto *result_sink = static_cast<muzloto::ResultSink *>(sink);
+  if (!result_sink || !cells || row_count < 0) {
+    return 0;
+  }
+
+  const size_t count = static_cast<size_t>(row_count) *
+                       result_sink->column_count();
+  std::vector<std::string> values;
+  values.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    values.emplace_back(cells[i] ? cells[i] : "");
+  }
+  return result_sink->append(values) ? 1 : 0;
+}
+
+MUZLOTO_EXPORT int64_t muzloto_sink_rows(void *sink) {
+  return sink ? static_cast<muzloto::ResultSink *>(sink)->rows() : 0;
+}
+
+MUZLOTO_EXPORT void muzloto_sink_close(void *sink) {
+  delete static_cast<muzloto::ResultSink *>(sink);
+}
+
+MUZLOTO_EXPORT void *muzloto_ingest_open(void *pool, void *sink,
+                                         const char *folder,
+                                         const char *journal_path,
+                                         const char **column_keys,
+                                         int column_count, int batch_size) {
+  if (!pool || !sink || !folder || !journal_path || !column_keys ||
+      column_count <= 0) {
+    return nullptr;
+  }
+  std::vector<std::string> keys;
+  for (int i = 0; i < column_count; i++) {
+    keys.emplace_back(column_keys[i] ? column_keys[i] : "");
+  }
+
+  try {
+    auto ingest = std::make_unique<muzloto::FolderIngest>(
+        *static_cast<muzloto::ScannerPool *>(pool),
+        *static_cast<muzloto::ResultSink *>(sink), folder, journal_path, keys,
+        batch_size > 0 ? static_cast<size_t>(batch_size) : 0);
+    return ingest->is_ready() ? ingest.release() : nullptr;
+  } catch (const std::exception &e) {
+    std::cerr << "Ошибка наблюдения за папкой " << folder << ": " << e.what()
+              << std::endl;
+    return nullptr;
+  }
+}
+
+MUZLOTO_EXPORT const char *muzloto_ingest_step(void *ingest, int timeout_ms) {
+  try {
+    auto stats =
+        static_cast<muzloto::FolderIngest *>(ingest)->step(timeout_ms);
+    nlohmann::json j = {{"success", true},
+                        {"committed", stats.committed},
+                        {"succeeded", stats.succeeded},
+                        {"failed", stats.failed},
+                        {"skipped", stats.skipped},
+                        {"cache_hits", stats.cache_hits},
+                        {"pending", stats.pending},
+                        {"retrying", stats.retrying},
+                        {"settling", stats.settling},
+                        {"watching", stats.watching}};
+    return muzloto::to_c_string(j.dump());
+  } catch (const std::exception &e) {
+    return muzloto::to_c_string(
+        muzloto::error_to_json(std::string("C++ exception: ") + e.what())
+            .dump());
+  }
+}
+
+MUZLOTO_EXPORT void muzloto_ingest_close(void *ingest) {
+  delete static_cast<muzloto::FolderIngest *>(ingest);
+}
+
+MUZLOTO_EXPORT void muzloto_free_result(MuzlotoResult *results) {
+  free(results);
+}
+
+// Снимок метрик процесса: format "json" (NULL) или "openmetrics" (текст
+// для Prometheus). NULL — неизвестный формат. Освобождается через
+// muzloto_free_string.
+MUZLOTO_EXPORT const char *muzloto_metrics_snapshot(const char *format) {
+  std::string name = format ? format : "json";
+  if (name == "json") {
+    return muzloto::to_c_string(
+        muzloto::Metrics::global().snapshot_json().dump());
+  }
+  if (name == "openmetrics") {
+    return muzloto::to_c_string(
+        muzloto::Metrics::global().snapshot_openmetrics());
+  }
+  return nullptr;
 }
 
 MUZLOTO_EXPORT void muzloto_free_string(const char *str) {
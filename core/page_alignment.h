@@ -0,0 +1,182 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace muzloto {
+
+struct AlignmentResult {
+  cv::Mat homography; // 3x3 CV_64F: исходное изображение -> страница
+  bool page_found = false;
+};
+
+// Выравнивание снимка с телефона: ищет четырёхугольник страницы и
+// перспективно приводит его к фиксированному размеру. Все последующие
+// этапы работают с небольшим изображением одного размера, а области
+// шаблона попадают на свои места.
+class PageAligner {
+public:
+  static constexpr int default_width = 1240;
+  static constexpr int default_height = 1860;
+
+  PageAligner(int width = default_width, int height = default_height)
+      : width(width), height(height) {}
+
+  // page — страница в каноническом разрешении; reduced — рабочий буфер
+  // уменьшенного снимка. Память переиспользуется, если буферы уже нужного
+  // размера.
+  AlignmentResult align(const cv::Mat &image, cv::Mat &page,
+                        cv::Mat &reduced) const {
+    AlignmentResult result;
+    std::vector<cv::Point2f> corners;
+
+    if (find_page_quad(image, corners)) {
+      std::vector<cv::Point2f> target = {
+          cv::Point2f(0, 0), cv::Point2f(static_cast<float>(width - 1), 0),
+          cv::Point2f(static_cast<float>(width - 1),
+                      static_cast<float>(height - 1)),
+          cv::Point2f(0, static_cast<float>(height - 1))};
+      result.homography = cv::getPerspectiveTransform(corners, target);
+      result.page_found = true;
+    } else {
+      // Страница не найдена — просто масштабируем снимок целиком
+      result.homography = cv::Mat::eye(3, 3, CV_64F);
+      result.homography.at<double>(0, 0) =
+          static_cast<double>(width) / image.cols;
+      result.homography.at<double>(1, 1) =
+          static_cast<double>(height) / image.rows;
+      corners = {cv::Point2f(0, 0),
+                 cv::Point2f(static_cast<float>(image.cols - 1), 0),
+                 cv::Point2f(static_cast<float>(image.cols - 1),
+                             static_cast<float>(image.rows - 1)),
+                 cv::Point2f(0, static_cast<float>(image.rows - 1))};
+    }
+
+    // warpPerspective не умеет INTER_AREA (молча берёт INTER_LINEAR), а
+    // билинейная выборка при уменьшении в 3–4 раза даёт алиасинг на
+    // тонких штрихах текста. Поэтому снимок сначала уменьшается с
+    // усреднением примерно до размера страницы, а перспектива
+    // накладывается уже почти без масштаба.
+    const double scale = reduction(corners);
+    const cv::Mat *source = &image;
+    cv::Mat warp = result.homography;
+    if (scale < max_direct_scale) {
+      cv::resize(image, reduced, cv::Size(), scale, scale, cv::INTER_AREA);
+      // Центры пикселей: x = (x' + 0.5) * cols / cols' - 0.5
+      const double sx = static_cast<double>(image.cols) / reduced.cols;
+      const double sy = static_cast<double>(image.rows) / reduced.rows;
+      cv::Mat to_source = (cv::Mat_<double>(3, 3) << sx, 0, 0.5 * sx - 0.5,
+                           0, sy, 0.5 * sy - 0.5, 0, 0, 1);
+      warp = result.homography * to_source;
+      source = &reduced;
+    }
+
+    cv::warpPerspective(*source, page, warp, cv::Size(width, height),
+                        cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    return result;
+  }
+
+private:
+  // До такого уменьшения билинейной выборки достаточно
+  static constexpr double max_direct_scale = 0.8;
+
+  int width;
+  int height;
+
+  // Во сколько раз уменьшить снимок, чтобы четырёхугольник страницы
+  // стал не меньше целевого размера по обеим сторонам (не больше 1)
+  double reduction(const std::vector<cv::Point2f> &corners) const {
+    auto side = [&corners](int a, int b) {
+      return std::hypot(corners[a].x - corners[b].x,
+                        corners[a].y - corners[b].y);
+    };
+    const double quad_width = std::max(side(1, 0), side(2, 3));
+    const double quad_height = std::max(side(3, 0), side(2, 1));
+    if (quad_width < 1 || quad_height < 1) {
+      return 1.0;
+    }
+    return std::min(1.0, std::max(width / quad_width, height / quad_height));
+  }
+
+  // Поиск выполняется на уменьшенной копии: контур страницы крупный,
+  // а Canny и findContours на 12+ Мп заметно дороже
+  bool find_page_quad(const cv::Mat &image,
+                      std::vector<cv::Point2f> &corners) const {
+    const double detect_side = 800.0;
+    double scale =
+        std::min(1.0, detect_side / std::max(image.cols, image.rows));
+
+    cv::Mat small, gray, edges;
+    if (scale < 1.0) {
+      cv::resize(image, small, cv::Size(), scale, scale, cv::INTER_AREA);
+    } else {
+      small = image;
+    }
+
+    if (small.channels() == 1) {
+      gray = small;
+    } else {
+      cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    }
+    cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+    cv::Canny(gray, edges, 50, 150);
+    cv::dilate(edges, edges,
+               cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
+
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(edges, contours, cv::RETR_EXTERNAL,
+                     cv::CHAIN_APPROX_SIMPLE);
+
+    const double min_area = 0.2 * small.cols * small.rows;
+    double best_area = 0;
+    std::vector<cv::Point> best_quad;
+
+    for (const auto &contour : contours) {
+      double area = cv::contourArea(contour);
+      if (area < min_area || area <= best_area) {
+        continue;
+      }
+
+      std::vector<cv::Point> quad;
+      cv::approxPolyDP(contour, quad, 0.02 * cv::arcLength(contour, true),
+                       true);
+      if (quad.size() == 4 && cv::isContourConvex(quad)) {
+        best_area = area;
+        best_quad = quad;
+      }
+    }
+
+    if (best_quad.empty()) {
+      return false;
+    }
+
+    corners.clear();
+    for (const auto &p : best_quad) {
+      corners.emplace_back(static_cast<float>(p.x / scale),
+                           static_cast<float>(p.y / scale));
+    }
+    order_corners(corners);
+    return true;
+  }
+
+  // Порядок углов: левый верхний, правый верхний, правый нижний, левый
+  // нижний
+  static void order_corners(std::vector<cv::Point2f> &corners) {
+    auto by_sum = [](const cv::Point2f &a, const cv::Point2f &b) {
+      return a.x + a.y < b.x + b.y;
+    };
+    auto by_diff = [](const cv::Point2f &a, const cv::Point2f &b) {
+      return a.y - a.x < b.y - b.x;
+    };
+
+    cv::Point2f tl = *std::min_element(corners.begin(), corners.end(), by_sum);
+    cv::Point2f br = *std::max_element(corners.begin(), corners.end(), by_sum);
+    cv::Point2f tr = *std::min_element(corners.begin(), corners.end(), by_diff);
+    cv::Point2f bl = *std::max_element(corners.begin(), corners.end(), by_diff);
+    corners = {tl, tr, br, bl};
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+namespace muzloto {
+
+// Разбиение входного файла на отдельные анкеты: каждая страница
+// многостраничного TIFF и каждая анкета на снимке, где их несколько
+// (две анкеты на одном фото, стопка листов на планшетном сканере).
+// Найденные области затем распознаются параллельно, как отдельные
+// изображения.
+class PageSplitter {
+public:
+  // Анкета занимает хотя бы такую долю снимка
+  static constexpr double min_form_share = 0.015;
+  // Допустимое отношение короткой стороны к длинной (A4 — около 0.71)
+  static constexpr double min_aspect = 0.45;
+  static constexpr double max_aspect = 0.95;
+
+  // Все страницы файла; обычные форматы дают одну страницу. Пусто —
+  // файл не прочитался.
+  static std::vector<cv::Mat> read_pages(const std::string &path) {
+    std::vector<cv::Mat> pages;
+    try {
+      cv::imreadmulti(path, pages, cv::IMREAD_COLOR);
+    } catch (const cv::Exception &) {
+      pages.clear();
+    }
+    if (pages.empty()) {
+      cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+      if (!image.empty()) {
+        pages.push_back(image);
+      }
+    }
+    return pages;
+  }
+
+  // Области анкет на странице в порядке чтения (сверху вниз, слева
+  // направо). Если отдельных листов меньше двух, возвращает всю страницу —
+  // одиночную анкету выравнивает PageAligner.
+  static std::vector<cv::Rect> find_forms(const cv::Mat &image) {
+    const cv::Rect whole(0, 0, image.cols, image.rows);
+    const double detect_side = 1000.0;
+    double scale =
+        std::min(1.0, detect_side / std::max(image.cols, image.rows));
+
+    cv::Mat small, gray, edges;
+    if (scale < 1.0) {
+      cv::resize(image, small, cv::Size(), scale, scale, cv::INTER_AREA);
+    } else {
+      small = image;
+    }
+    if (small.channels() == 1) {
+      gray = small;
+    } else {
+      cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    }
+    cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+    cv::Canny(gray, edges, 50, 150);
+    cv::dilate(edges, edges,
+               cv::getStructuringElement(cv::MORPH_RECT, cv::Size(3, 3)));
+
+    // Внешние контуры: рамки и таблицы внутри листа сюда не попадают
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(edges, contours, cv::RETR_EXTERNAL,
+                     cv::CHAIN_APPROX_SIMPLE);
+
+    const double min_area = min_form_share * small.cols * small.rows;
+    std::vector<cv::Rect> candidates;
+    for (const auto &contour : contours) {
+      if (cv::contourArea(contour) < min_area) {
+        continue;
+      }
+      std::vector<cv::Point> quad;
+      cv::approxPolyDP(contour, quad, 0.02 * cv::arcLength(contour, true),
+                       true);
+      if (quad.size() != 4 || !cv::isContourConvex(quad)) {
+        continue;
+      }
+      cv::Rect box = cv::boundingRect(quad);
+      double aspect = static_cast<double>(std::min(box.width, box.height)) /
+                      std::max(box.width, box.height);
+      if (aspect >= min_aspect && aspect <= max_aspect) {
+        candidates.push_back(box);
+      }
+    }
+
+    // От крупных к мелким; области внутри уже выбранных отбрасываются
+    std::sort(candidates.begin(), candidates.end(),
+              [](const cv::Rect &a, const cv::Rect &b) {
+                return a.area() > b.area();
+              });
+    std::vector<cv::Rect> forms;
+    for (const auto &box : candidates) {
+      bool overlaps = std::any_of(
+          forms.begin(), forms.end(), [&box](const cv::Rect &kept) {
+            return (box & kept).area() > 0.1 * box.area();
+          });
+      if (!overlaps) {
+        forms.push_back(box);
+      }
+    }
+    if (forms.size() < 2) {
+      return {whole};
+    }
+
+    // Обратно в координаты страницы, с полем вокруг листа: выравниванию
+    // нужен край страницы на фоне
+    for (auto &box : forms) {
+      int pad_x = box.width / 50 + 1;
+      int pad_y = box.height / 50 + 1;
+      cv::Rect scaled(static_cast<int>((box.x - pad_x) / scale),
+                      static_cast<int>((box.y - pad_y) / scale),
+                      static_cast<int>((box.width + 2 * pad_x) / scale),
+                      static_cast<int>((box.height + 2 * pad_y) / scale));
+      box = scaled & whole;
+    }
+    sort_reading_order(forms);
+    return forms;
+  }
+
+private:
+  // Ряды листов по вертикали, внутри ряда — слева направо
+  static void sort_reading_order(std::vector<cv::Rect> &forms) {
+    std::sort(forms.begin(), forms.end(),
+              [](const cv::Rect &a, const cv::Rect &b) { return a.y < b.y; });
+
+    auto row_start = forms.begin();
+    while (row_start != forms.end()) {
+      const int row_limit = row_start->y + row_start->height / 2;
+      auto row_end = std::find_if(
+          row_start, forms.end(),
+          [row_limit](const cv::Rect &r) { return r.y >= row_limit; });
+      std::sort(row_start, row_end, [](const cv::Rect &a, const cv::Rect &b) {
+        return a.x < b.x;
+      });
+      row_start = row_end;
+    }
+  }
+};
+
+} // namespace muzloto
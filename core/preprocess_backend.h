@@ -0,0 +1,105 @@
+#pragma once
+
+#include <opencv2/core/ocl.hpp>
+#include <opencv2/opencv.hpp>
+#include <string>
+
+#ifdef MUZLOTO_WITH_CUDA
+#include <opencv2/core/cuda.hpp>
+#include <opencv2/cudafilters.hpp>
+#include <opencv2/cudaimgproc.hpp>
+#include <opencv2/photo/cuda.hpp>
+#endif
+
+namespace muzloto {
+
+// Где выполняется предобработка (серый, шумоподавление, контраст,
+// бинаризация). На серверах с видеокартой — встроенной (OpenCL) или
+// NVIDIA (CUDA) — она уходит с ядер, которые нужны Tesseract.
+//
+// Наличие устройства проверяется при выборе бэкенда; если ускоритель
+// отказал уже во время работы, сканер переходит на CPU.
+enum class PreprocessBackend {
+  Cpu,
+  OpenCL, // T-API (cv::UMat)
+  Cuda,   // модули cuda* OpenCV; только при сборке с MUZLOTO_WITH_CUDA
+};
+
+inline const char *backend_name(PreprocessBackend backend) {
+  switch (backend) {
+  case PreprocessBackend::OpenCL:
+    return "opencl";
+  case PreprocessBackend::Cuda:
+    return "cuda";
+  default:
+    return "cpu";
+  }
+}
+
+inline bool cuda_available() {
+#ifdef MUZLOTO_WITH_CUDA
+  try {
+    return cv::cuda::getCudaEnabledDeviceCount() > 0;
+  } catch (const cv::Exception &) {
+    return false;
+  }
+#else
+  return false;
+#endif
+}
+
+inline bool opencl_available() {
+  try {
+    if (!cv::ocl::haveOpenCL()) {
+      return false;
+    }
+    cv::ocl::setUseOpenCL(true);
+    return cv::ocl::useOpenCL();
+  } catch (const cv::Exception &) {
+    return false;
+  }
+}
+
+// "cpu", "opencl", "cuda" или "auto" (лучший доступный). Запрошенный, но
+// недоступный на этой машине ускоритель заменяется на CPU. false —
+// неизвестное имя.
+inline bool resolve_preprocess_backend(const std::string &name,
+                                       PreprocessBackend &backend) {
+  if (name == "cpu") {
+    backend = PreprocessBackend::Cpu;
+  } else if (name == "opencl") {
+    backend = opencl_available() ? PreprocessBackend::OpenCL
+                                 : PreprocessBackend::Cpu;
+  } else if (name == "cuda") {
+    backend =
+        cuda_available() ? PreprocessBackend::Cuda : PreprocessBackend::Cpu;
+  } else if (name == "auto") {
+    backend = cuda_available()     ? PreprocessBackend::Cuda
+              : opencl_available() ? PreprocessBackend::OpenCL
+                                   : PreprocessBackend::Cpu;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Буферы на устройстве; живут в WorkBuffers, чтобы не выделять память
+// видеокарты на каждый скан
+struct DeviceBuffers {
+  cv::UMat source;
+  cv::UMat gray;
+  cv::UMat denoised;
+  cv::UMat equalized;
+  cv::UMat binary;
+#ifdef MUZLOTO_WITH_CUDA
+  cv::cuda::GpuMat gpu_source;
+  cv::cuda::GpuMat gpu_gray;
+  cv::cuda::GpuMat gpu_denoised;
+  cv::cuda::GpuMat gpu_equalized;
+  cv::Ptr<cv::cuda::Filter> median;
+#endif
+  // Ускоритель отказал во время работы: дальше этими буферами — только CPU
+  bool failed = false;
+};
+
+} // namespace muzloto
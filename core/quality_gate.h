@@ -0,0 +1,148 @@
+#pragma once
+
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <string>
+
+namespace muzloto {
+
+// Быстрая проверка снимка до предобработки и OCR. Размытое фото, пустая
+// оборотная сторона или случайный снимок стола иначе проходят полное
+// шумоподавление и LSTM, прежде чем разбор не найдёт ни одного вопроса.
+// Проверка идёт на миниатюре и занимает единицы миллисекунд:
+//  - доля «чернил» после адаптивной бинаризации — пустой лист или сплошная
+//    текстура вместо бумаги с текстом;
+//  - число строк текста по горизонтальной проекции — у анкеты их
+//    десятки, у фотографии стола или пустого листа почти нет;
+//  - дисперсия лапласиана — резкость.
+//
+// Проверка хранит рабочие матрицы, поэтому живёт в буферах сканера.
+enum class QualityGateMode {
+  Off,    // не проверять
+  Flag,   // измерить и сообщить причину, но распознавать
+  Reject, // не распознавать непригодные снимки
+};
+
+inline bool parse_quality_gate_mode(const std::string &name,
+                                    QualityGateMode &mode) {
+  if (name == "off") {
+    mode = QualityGateMode::Off;
+  } else if (name == "flag") {
+    mode = QualityGateMode::Flag;
+  } else if (name == "reject") {
+    mode = QualityGateMode::Reject;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+struct QualityReport {
+  bool checked = false;
+  std::string reason;      // код причины; пусто — снимок пригоден
+  double sharpness = 0;    // дисперсия лапласиана миниатюры
+  double ink_density = 0;  // доля тёмных пикселей
+  int text_lines = 0;      // строки текста на миниатюре
+
+  bool usable() const { return reason.empty(); }
+
+  // Сообщение для error_message
+  std::string message() const {
+    if (reason == "blank") {
+      return "Пустое изображение: на снимке нет текста";
+    }
+    if (reason == "not_a_form") {
+      return "На снимке не найдена анкета";
+    }
+    if (reason == "blurry") {
+      return "Снимок слишком размыт для распознавания";
+    }
+    return "";
+  }
+};
+
+class QualityGate {
+public:
+  static constexpr int thumbnail_side = 640;
+  static constexpr double min_ink_density = 0.004;
+  static constexpr double max_ink_density = 0.3;
+  static constexpr int min_text_lines = 6;
+  static constexpr double min_sharpness = 25.0;
+
+  QualityReport check(const cv::Mat &image) {
+    QualityReport report;
+    report.checked = true;
+    if (image.empty()) {
+      return report;
+    }
+
+    double scale = std::min(
+        1.0, static_cast<double>(thumbnail_side) /
+                 std::max(image.cols, image.rows));
+    if (scale < 1.0) {
+      cv::resize(image, thumbnail, cv::Size(), scale, scale, cv::INTER_AREA);
+    } else {
+      thumbnail = image;
+    }
+    if (thumbnail.channels() == 1) {
+      gray = thumbnail;
+    } else {
+      cv::cvtColor(thumbnail, gray,
+                   thumbnail.channels() == 4 ? cv::COLOR_BGRA2GRAY
+                                             : cv::COLOR_BGR2GRAY);
+    }
+
+    cv::adaptiveThreshold(gray, ink, 255, cv::ADAPTIVE_THRESH_MEAN_C,
+                          cv::THRESH_BINARY_INV, 15, 10);
+    report.ink_density =
+        static_cast<double>(cv::countNonZero(ink)) / ink.total();
+    report.text_lines = count_text_lines(ink);
+
+    cv::Laplacian(gray, laplacian, CV_16S);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian, mean, stddev);
+    report.sharpness = stddev[0] * stddev[0];
+
+    if (report.ink_density < min_ink_density) {
+      report.reason = "blank";
+    } else if (report.ink_density > max_ink_density ||
+               report.text_lines < min_text_lines) {
+      report.reason = "not_a_form";
+    } else if (report.sharpness < min_sharpness) {
+      report.reason = "blurry";
+    }
+    return report;
+  }
+
+private:
+  cv::Mat thumbnail;
+  cv::Mat gray;
+  cv::Mat ink;
+  cv::Mat laplacian;
+  cv::Mat profile;
+
+  // Строка текста — полоса подряд идущих рядов с умеренной долей чернил.
+  // Сплошная текстура даёт одну очень высокую полосу и не считается.
+  int count_text_lines(const cv::Mat &binary) {
+    cv::reduce(binary, profile, 1, cv::REDUCE_SUM, CV_32S);
+    const double row_max = 255.0 * binary.cols;
+    const int max_line_height = std::max(4, binary.rows / 15);
+
+    int lines = 0;
+    int run = 0;
+    for (int y = 0; y <= binary.rows; y++) {
+      double fill = y < binary.rows ? profile.at<int>(y, 0) / row_max : 0.0;
+      if (fill >= 0.01 && fill <= 0.5) {
+        run++;
+        continue;
+      }
+      if (run >= 2 && run <= max_line_height) {
+        lines++;
+      }
+      run = 0;
+    }
+    return lines;
+  }
+};
+
+} // namespace muzloto
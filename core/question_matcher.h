@@ -0,0 +1,245 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace muzloto {
+
+// Классификатор строк OCR по вопросам анкеты.
+//
+// Точный поиск — автомат Ахо–Корасик над байтами UTF-8, построенный один
+// раз: строка проходится за один проход независимо от числа вопросов.
+// Если точного совпадения нет, выполняется нечёткий поиск с ограниченным
+// расстоянием Левенштейна по символам (OCR часто путает отдельные буквы:
+// "Музлото" -> "Музлого").
+class QuestionMatcher {
+public:
+  // edits_per_char — допустимая доля правок (0.1 — одна на 10 символов);
+  // вопросы короче 1 / edits_per_char символов ищутся только точно
+  explicit QuestionMatcher(const std::vector<std::string> &patterns,
+                           double edits_per_char = 0.1) {
+    build_automaton(patterns);
+
+    for (const auto &pattern : patterns) {
+      std::vector<char32_t> cps = decode_utf8(pattern);
+      max_edits.push_back(static_cast<int>(cps.size() * edits_per_char));
+      codepoints.push_back(std::move(cps));
+    }
+  }
+
+  // Наименьший индекс вопроса, целиком входящего в строку, или -1
+  int match_exact(const std::string &line) const {
+    int state = 0;
+    int best = -1;
+    for (unsigned char byte : line) {
+      state = delta[state * alphabet_size + byte_class[byte]];
+      int found = output[state];
+      if (found >= 0 && (best < 0 || found < best)) {
+        best = found;
+      }
+    }
+    return best;
+  }
+
+  // Точное совпадение, иначе вопрос с наименьшим числом правок в
+  // пределах допуска; -1, если строка не похожа ни на один вопрос
+  int match(const std::string &line) const {
+    int exact = match_exact(line);
+    if (exact >= 0) {
+      return exact;
+    }
+
+    std::vector<char32_t> text = decode_utf8(line);
+    std::vector<int> column;
+    int best = -1;
+    // Лучший результат — best_distance правок на best_size символов
+    size_t best_distance = 0;
+    size_t best_size = 1;
+    for (size_t i = 0; i < codepoints.size(); i++) {
+      const size_t size = codepoints[i].size();
+      int k = max_edits[i];
+      if (best >= 0) {
+        if (best_distance == 0) {
+          break; // точнее не бывает
+        }
+        // Выигрывает только distance / size < best_distance / best_size
+        k = std::min<int>(k, (best_distance * size - 1) / best_size);
+      }
+      // Короче вопроса больше чем на k символов — совпасть не может
+      if (k <= 0 || text.size() + k < size) {
+        continue;
+      }
+
+      int distance = substring_distance(codepoints[i], text, k, column);
+      if (distance > k) {
+        continue;
+      }
+      best = static_cast<int>(i);
+      best_distance = distance;
+      best_size = size;
+    }
+    return best;
+  }
+
+private:
+  // Алфавит сжимается до байтов, встречающихся в вопросах (класс 0 — все
+  // остальные), чтобы полная таблица переходов оставалась небольшой
+  std::array<int, 256> byte_class{};
+  int alphabet_size = 1;
+  std::vector<int> delta;  // state * alphabet_size + class -> state
+  std::vector<int> output; // наименьший индекс вопроса, оканчивающегося тут
+
+  std::vector<std::vector<char32_t>> codepoints;
+  std::vector<int> max_edits;
+
+  void build_automaton(const std::vector<std::string> &patterns) {
+    for (const auto &pattern : patterns) {
+      for (unsigned char byte : pattern) {
+        if (byte_class[byte] == 0) {
+          byte_class[byte] = alphabet_size++;
+        }
+      }
+    }
+
+    // Бор: -1 — перехода нет
+    std::vector<int> trie(alphabet_size, -1);
+    output.assign(1, -1);
+    for (size_t p = 0; p < patterns.size(); p++) {
+      int state = 0;
+      for (unsigned char byte : patterns[p]) {
+        size_t edge = state * alphabet_size + byte_class[byte];
+        if (trie[edge] < 0) {
+          trie[edge] = static_cast<int>(output.size());
+          output.push_back(-1);
+          trie.resize(trie.size() + alphabet_size, -1);
+        }
+        state = trie[edge];
+      }
+      if (output[state] < 0) {
+        output[state] = static_cast<int>(p);
+      }
+    }
+
+    // Обход в ширину: суффиксные ссылки превращают бор в полный автомат
+    delta = trie;
+    std::vector<int> fail(output.size(), 0);
+    std::deque<int> queue;
+    for (int c = 0; c < alphabet_size; c++) {
+      int next = trie[c];
+      if (next < 0) {
+        delta[c] = 0;
+      } else {
+        queue.push_back(next);
+      }
+    }
+
+    while (!queue.empty()) {
+      int state = queue.front();
+      queue.pop_front();
+
+      int inherited = output[fail[state]];
+      if (inherited >= 0 && (output[state] < 0 || inherited < output[state])) {
+        output[state] = inherited;
+      }
+
+      for (int c = 0; c < alphabet_size; c++) {
+        int next = trie[state * alphabet_size + c];
+        if (next < 0) {
+          delta[state * alphabet_size + c] =
+              delta[fail[state] * alphabet_size + c];
+        } else {
+          fail[next] = delta[fail[state] * alphabet_size + c];
+          queue.push_back(next);
+        }
+      }
+    }
+  }
+
+  // Минимальное расстояние Левенштейна между pattern и любой подстрокой
+  // text (алгоритм Селлерса). Расстояния больше допуска k возвращаются
+  // как k + 1. Считаются только строки столбца до последней со значением
+  // не больше k (отсечение Укконена): ниже неё допуск уже превышен.
+  static int substring_distance(const std::vector<char32_t> &pattern,
+                                const std::vector<char32_t> &text, int k,
+                                std::vector<int> &column) {
+    const size_t m = pattern.size();
+    column.resize(m + 1);
+    for (size_t i = 0; i <= m; i++) {
+      column[i] = static_cast<int>(i);
+    }
+
+    int best = k + 1;
+    // Последняя строка столбца со значением <= k
+    size_t last = std::min(m, static_cast<size_t>(k));
+    for (char32_t c : text) {
+      int diagonal = column[0]; // D[i-1][j-1]
+      column[0] = 0;            // совпадение может начаться где угодно
+      const size_t rows = std::min(m, last + 1);
+      for (size_t i = 1; i <= rows; i++) {
+        // Ниже last значения прошлых столбцов больше k — для решения,
+        // уложились ли в допуск, этого достаточно
+        int above = column[i]; // D[i][j-1]
+        int cost = pattern[i - 1] == c ? 0 : 1;
+        column[i] = std::min({diagonal + cost, above + 1, column[i - 1] + 1});
+        diagonal = above;
+      }
+      last = rows;
+      while (column[last] > k) {
+        last--;
+      }
+      if (last == m) {
+        best = std::min(best, column[m]);
+        if (best == 0) {
+          break;
+        }
+      }
+    }
+    return std::min(best, k + 1);
+  }
+
+  static std::vector<char32_t> decode_utf8(const std::string &str) {
+    std::vector<char32_t> result;
+    result.reserve(str.size());
+    for (size_t i = 0; i < str.size();) {
+      unsigned char c = str[i];
+      char32_t cp;
+      size_t len;
+      if (c < 0x80) {
+        cp = c;
+        len = 1;
+      } else if ((c >> 5) == 0x6) {
+        cp = c & 0x1F;
+        len = 2;
+      } else if ((c >> 4) == 0xE) {
+        cp = c & 0x0F;
+        len = 3;
+      } else if ((c >> 3) == 0x1E) {
+        cp = c & 0x07;
+        len = 4;
+      } else {
+        // Некорректный байт — берём как есть
+        result.push_back(c);
+        i++;
+        continue;
+      }
+
+      if (i + len > str.size()) {
+        result.push_back(c);
+        i++;
+        continue;
+      }
+      for (size_t k = 1; k < len; k++) {
+        cp = (cp << 6) | (static_cast<unsigned char>(str[i + k]) & 0x3F);
+      }
+      result.push_back(cp);
+      i += len;
+    }
+    return result;
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "content_hash.h"
+
+namespace muzloto {
+
+// Дисковый кэш результатов сканирования. Ключ — хеш содержимого файла
+// вместе с отпечатком настроек сканера, значение — сериализованный
+// результат. Повторный прогон process_folder по той же папке не
+// распознаёт уже обработанные анкеты заново.
+//
+// Каждая запись — отдельный файл <ключ>.json в каталоге кэша. Общий
+// размер ограничен max_bytes: при переполнении удаляются давно не
+// использованные записи (время использования — mtime файла, поэтому
+// порядок переживает перезапуск). Смена настроек меняет отпечаток, так что
+// старые записи просто перестают находиться и со временем вытесняются.
+class ResultCache {
+public:
+  ResultCache(const std::string &directory, size_t max_bytes)
+      : directory(directory), max_bytes(max_bytes) {
+    std::filesystem::create_directories(this->directory);
+    load_index();
+  }
+
+  ResultCache(const ResultCache &) = delete;
+  ResultCache &operator=(const ResultCache &) = delete;
+
+  bool get(uint64_t key, std::string &value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+      return false;
+    }
+
+    std::ifstream file(path_of(key), std::ios::binary);
+    if (!file) {
+      forget(it); // файл удалили снаружи
+      return false;
+    }
+    value.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+
+    // Самая свежая запись — в начале списка и с новым mtime
+    recency.splice(recency.begin(), recency, it->second.position);
+    std::error_code ignored;
+    std::filesystem::last_write_time(
+        path_of(key), std::filesystem::file_time_type::clock::now(), ignored);
+    return true;
+  }
+
+  void put(uint64_t key, const std::string &value) {
+    if (value.size() > max_bytes) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto existing = index.find(key);
+    if (existing != index.end()) {
+      forget(existing);
+    }
+
+    {
+      std::ofstream file(path_of(key), std::ios::binary | std::ios::trunc);
+      if (!file.write(value.data(), value.size())) {
+        return;
+      }
+    }
+    recency.push_front(key);
+    index[key] = {value.size(), recency.begin()};
+    total_bytes += value.size();
+
+    while (total_bytes > max_bytes && !recency.empty()) {
+      uint64_t oldest = recency.back();
+      std::error_code ignored;
+      std::filesystem::remove(path_of(oldest), ignored);
+      forget(index.find(oldest));
+    }
+  }
+
+  // Удаляет все записи
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint64_t key : recency) {
+      std::error_code ignored;
+      std::filesystem::remove(path_of(key), ignored);
+    }
+    index.clear();
+    recency.clear();
+    total_bytes = 0;
+  }
+
+  size_t size_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_bytes;
+  }
+
+  size_t entries() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.size();
+  }
+
+private:
+  struct Entry {
+    size_t size = 0;
+    std::list<uint64_t>::iterator position;
+  };
+
+  std::filesystem::path directory;
+  size_t max_bytes;
+  size_t total_bytes = 0;
+  std::list<uint64_t> recency; // от недавно использованных к давним
+  std::unordered_map<uint64_t, Entry> index;
+  mutable std::mutex mutex;
+
+  std::filesystem::path path_of(uint64_t key) const {
+    return directory / (hash::to_hex(key) + ".json");
+  }
+
+  void forget(std::unordered_map<uint64_t, Entry>::iterator it) {
+    total_bytes -= it->second.size;
+    recency.erase(it->second.position);
+    index.erase(it);
+  }
+
+  void load_index() {
+    struct Found {
+      uint64_t key;
+      size_t size;
+      std::filesystem::file_time_type time;
+    };
+    std::vector<Found> found;
+
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
+      const auto &path = entry.path();
+      std::string stem = path.stem().string();
+      if (!entry.is_regular_file() || path.extension() != ".json" ||
+          stem.size() != 16) {
+        continue;
+      }
+      try {
+        found.push_back({std::stoull(stem, nullptr, 16),
+                         static_cast<size_t>(entry.file_size()),
+                         entry.last_write_time()});
+      } catch (const std::exception &) {
+        // посторонний файл
+      }
+    }
+
+    std::sort(found.begin(), found.end(), [](const Found &a, const Found &b) {
+      return a.time > b.time;
+    });
+    for (const auto &f : found) {
+      recency.push_back(f.key);
+      index[f.key] = {f.size, std::prev(recency.end())};
+      total_bytes += f.size;
+    }
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+namespace muzloto {
+
+// Журнал результатов в CSV (UTF-8, кавычки по RFC 4180), в который строки
+// только дописываются. Пакет строк собирается в памяти и уходит на диск
+// одной записью, поэтому стоимость пакета не зависит от размера уже
+// накопленного журнала — в отличие от перезаписи всего файла Excel.
+// Оформленный XLSX строится из журнала один раз, когда он нужен.
+//
+// Заголовок пишется при создании файла; при повторном открытии число
+// строк восстанавливается чтением журнала.
+class ResultSink {
+public:
+  ResultSink(const std::string &path, std::vector<std::string> columns)
+      : path(path), columns(std::move(columns)) {
+    std::string repair;
+    bool empty = !count_rows(repair);
+
+    file.open(path, std::ios::binary | std::ios::app);
+    if (!file) {
+      return;
+    }
+
+    std::string prefix;
+    if (empty) {
+      prefix = "\xEF\xBB\xBF"; // BOM: Excel открывает файл как UTF-8
+      append_row(prefix, this->columns);
+    } else {
+      prefix = repair;
+    }
+    write(prefix);
+  }
+
+  ResultSink(const ResultSink &) = delete;
+  ResultSink &operator=(const ResultSink &) = delete;
+
+  bool is_open() const { return file.is_open() && file.good(); }
+
+  size_t column_count() const { return columns.size(); }
+
+  // Число строк с данными (без заголовка)
+  int64_t rows() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return row_count;
+  }
+
+  // Дописывает строки из cells (по column_count() ячеек подряд)
+  // одной записью в файл
+  bool append(const std::vector<std::string> &cells) {
+    if (columns.empty() || cells.size() % columns.size() != 0) {
+      return false;
+    }
+
+    std::string batch;
+    std::vector<std::string> row(columns.size());
+    for (size_t i = 0; i < cells.size(); i += columns.size()) {
+      row.assign(cells.begin() + i, cells.begin() + i + columns.size());
+      append_row(batch, row);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!write(batch)) {
+      return false;
+    }
+    row_count += static_cast<int64_t>(cells.size() / columns.size());
+    return true;
+  }
+
+  // Оставляет только первые rows строк — откат пакета, записанного не
+  // целиком. Файл дописывается в режиме app, поэтому следующая запись
+  // пойдёт с нового конца. false — строк меньше или файл не укоротился.
+  bool truncate(int64_t rows) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (rows < 0 || rows > row_count) {
+      return false;
+    }
+    if (rows == row_count) {
+      return true;
+    }
+    file.flush();
+    const int64_t offset = record_end(rows + 1); // с заголовком
+    if (offset < 0) {
+      return false;
+    }
+    std::error_code ec;
+    std::filesystem::resize_file(path, static_cast<uintmax_t>(offset), ec);
+    if (ec) {
+      return false;
+    }
+    row_count = rows;
+    return true;
+  }
+
+private:
+  std::string path;
+  std::vector<std::string> columns;
+  std::ofstream file;
+  int64_t row_count = 0;
+  mutable std::mutex mutex;
+
+  bool write(const std::string &data) {
+    if (data.empty()) {
+      return true;
+    }
+    file.write(data.data(), data.size());
+    file.flush();
+    return file.good();
+  }
+
+  static void append_cell(std::string &out, const std::string &cell) {
+    if (cell.find_first_of(",\"\r\n") == std::string::npos) {
+      out += cell;
+      return;
+    }
+    out += '"';
+    for (char c : cell) {
+      if (c == '"') {
+        out += '"';
+      }
+      out += c;
+    }
+    out += '"';
+  }
+
+  static void append_row(std::string &out,
+                         const std::vector<std::string> &row) {
+    for (size_t i = 0; i < row.size(); i++) {
+      if (i > 0) {
+        out += ',';
+      }
+      append_cell(out, row[i]);
+    }
+    out += '\n';
+  }
+
+  // Смещение сразу после записи номер records (с 1) или -1
+  int64_t record_end(int64_t records) const {
+    std::ifstream in(path, std::ios::binary);
+    bool quoted = false;
+    int64_t seen = 0;
+    int64_t offset = 0;
+    char chunk[1 << 16];
+    while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+      std::streamsize n = in.gcount();
+      for (std::streamsize i = 0; i < n; i++) {
+        if (chunk[i] == '"') {
+          quoted = !quoted;
+        } else if (chunk[i] == '\n' && !quoted && ++seen == records) {
+          return offset + i + 1;
+        }
+      }
+      offset += n;
+    }
+    return -1;
+  }
+
+  // Считает записи уже существующего журнала; переводы строк внутри
+  // кавычек записей не разделяют. В repair — то, что закроет оборванную
+  // последнюю запись. false — файла нет или он пуст.
+  bool count_rows(std::string &repair) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      return false;
+    }
+
+    int64_t records = 0;
+    bool quoted = false;
+    char last = '\n';
+    bool any = false;
+    char chunk[1 << 16];
+    while (in.read(chunk, sizeof(chunk)) || in.gcount() > 0) {
+      std::streamsize n = in.gcount();
+      for (std::streamsize i = 0; i < n; i++) {
+        char c = chunk[i];
+        if (c == '"') {
+          quoted = !quoted;
+        } else if (c == '\n' && !quoted) {
+          records++;
+        }
+        last = c;
+      }
+      any = any || n > 0;
+    }
+    if (!any) {
+      return false;
+    }
+
+    if (quoted || last != '\n') {
+      repair = quoted ? "\"\n" : "\n";
+      records++; // оборванная строка всё равно занимает запись
+    }
+    row_count = records > 0 ? records - 1 : 0;
+    return true;
+  }
+};
+
+} // namespace muzloto
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Ручные сканеры для извлечения значений из распознанного текста.
+// Повторяют поведение прежних std::regex_search, но не компилируют
+// регулярное выражение на каждый вызов и проходят строку один раз.
+namespace muzloto {
+namespace extract {
+
+inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// Аналог \s для однобайтовой классической локали
+inline bool is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' ||
+         c == '\r';
+}
+
+// Первое вхождение (10|[1-9]). Пустая строка, если число не найдено.
+inline std::string find_rating(const std::string &text) {
+  for (size_t i = 0; i < text.size(); i++) {
+    char c = text[i];
+    if (c == '1' && i + 1 < text.size() && text[i + 1] == '0') {
+      return "10";
+    }
+    if (c >= '1' && c <= '9') {
+      return std::string(1, c);
+    }
+  }
+  return "";
+}
+
+namespace detail {
+
+// Необязательный разделитель: класс символов не пересекается с цифрами,
+// поэтому жадный выбор совпадает с результатом поиска с возвратом
+template <typename IsSeparator>
+inline void skip_separator(const std::string &text, size_t &pos,
+                           IsSeparator is_separator) {
+  if (pos < text.size() && is_separator(text[pos])) {
+    pos++;
+  }
+}
+
+inline bool take_digits(const std::string &text, size_t &pos, size_t count) {
+  for (size_t k = 0; k < count; k++, pos++) {
+    if (pos >= text.size() || !is_digit(text[pos])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Хвост номера после префикса:
+// [\s\-\(]?\d{3}[\s\-\)]?\d{3}[\s\-]?\d{2}[\s\-]?\d{2}
+inline bool match_phone_tail(const std::string &text, size_t pos,
+                             size_t &end) {
+  skip_separator(text, pos,
+                 [](char c) { return is_space(c) || c == '-' || c == '('; });
+  if (!take_digits(text, pos, 3)) {
+    return false;
+  }
+  skip_separator(text, pos,
+                 [](char c) { return is_space(c) || c == '-' || c == ')'; });
+  if (!take_digits(text, pos, 3)) {
+    return false;
+  }
+  skip_separator(text, pos, [](char c) { return is_space(c) || c == '-'; });
+  if (!take_digits(text, pos, 2)) {
+    return false;
+  }
+  skip_separator(text, pos, [](char c) { return is_space(c) || c == '-'; });
+  if (!take_digits(text, pos, 2)) {
+    return false;
+  }
+  end = pos;
+  return true;
+}
+
+} // namespace detail
+
+// Первое вхождение номера (\+7|8)... Возвращает начало и длину совпадения.
+inline bool find_phone(const std::string &text, size_t &match_pos,
+                       size_t &match_len) {
+  size_t end = 0;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '+' && i + 1 < text.size() && text[i + 1] == '7' &&
+        detail::match_phone_tail(text, i + 2, end)) {
+      match_pos = i;
+      match_len = end - i;
+      return true;
+    }
+    if (text[i] == '8' && detail::match_phone_tail(text, i + 1, end)) {
+      match_pos = i;
+      match_len = end - i;
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace extract
+} // namespace muzloto
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace muzloto {
+
+// Нормализация разрешения перед OCR. Время Tesseract растёт с числом
+// пикселей, а качество перестаёт расти, когда высота символов достигает
+// примерно 300 DPI. Снимок с телефона (12–48 Мп) уменьшается так, чтобы
+// медианная высота символа стала target_height пикселей.
+//
+// Оценщик хранит рабочие матрицы, поэтому живёт в буферах сканера.
+struct TextScale {
+  double text_height = 0; // медианная высота символа до масштабирования
+  double scale = 1.0;     // < 1 — изображение уменьшается
+  int source_ppi = 0;     // оценка разрешения для SetSourceResolution
+};
+
+class TextScaleEstimator {
+public:
+  // Высота строчных букв при ~300 DPI для кегля 10–12
+  static constexpr int default_text_height = 24;
+  static constexpr int reference_ppi = 300;
+
+  // binary — результат adaptiveThreshold (текст чёрный на белом)
+  TextScale estimate(const cv::Mat &binary,
+                     int target_height = default_text_height) {
+    TextScale result;
+    result.text_height = median_glyph_height(binary);
+    if (result.text_height <= 0) {
+      return result; // мало символов — оценке нельзя доверять
+    }
+
+    result.scale = std::min(1.0, target_height / result.text_height);
+    // Не тратим время на почти незаметное уменьшение
+    if (result.scale > 0.9) {
+      result.scale = 1.0;
+    }
+    result.source_ppi = std::clamp(
+        static_cast<int>(reference_ppi * result.text_height * result.scale /
+                         target_height),
+        70, 2400);
+    return result;
+  }
+
+private:
+  static constexpr size_t min_glyphs = 30;
+
+  cv::Mat inverted;
+  cv::Mat labels;
+  cv::Mat stats;
+  cv::Mat centroids;
+  std::vector<int> heights;
+
+  // Медианная высота связных компонент, похожих на символы; 0, если их
+  // меньше min_glyphs
+  double median_glyph_height(const cv::Mat &binary) {
+    cv::bitwise_not(binary, inverted);
+    int count = cv::connectedComponentsWithStats(inverted, labels, stats,
+                                                 centroids, 8, CV_32S);
+
+    heights.clear();
+    const int max_height = std::max(8, binary.rows / 20);
+    for (int i = 1; i < count; i++) { // 0 — фон
+      int width = stats.at<int>(i, cv::CC_STAT_WIDTH);
+      int height = stats.at<int>(i, cv::CC_STAT_HEIGHT);
+      int area = stats.at<int>(i, cv::CC_STAT_AREA);
+      // Отсекаем шум, линии разметки и рамки
+      if (height < 4 || height > max_height || width > 3 * height ||
+          area < 0.1 * width * height) {
+        continue;
+      }
+      heights.push_back(height);
+    }
+
+    if (heights.size() < min_glyphs) {
+      return 0;
+    }
+    auto middle = heights.begin() + heights.size() / 2;
+    std::nth_element(heights.begin(), middle, heights.end());
+    return *middle;
+  }
+};
+
+} // namespace muzloto
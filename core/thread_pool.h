@@ -0,0 +1,115 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace muzloto {
+
+// Счётчик незавершённых задач: wait() блокирует, пока done() не будет
+// вызван столько раз, сколько задач было заявлено.
+class WaitGroup {
+public:
+  explicit WaitGroup(size_t count = 0) : pending(count) {}
+
+  void add(size_t count = 1) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending += count;
+  }
+
+  void done() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending > 0 && --pending == 0) {
+      cv.notify_all();
+    }
+  }
+
+  void wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return pending == 0; });
+  }
+
+private:
+  size_t pending;
+  std::mutex mutex;
+  std::condition_variable cv;
+};
+
+// Пул потоков фиксированного размера. Каждая задача получает индекс
+// рабочего потока, чтобы пользоваться его личными ресурсами (например,
+// собственным экземпляром TessBaseAPI).
+class ThreadPool {
+public:
+  using Task = std::function<void(size_t worker)>;
+
+  explicit ThreadPool(size_t n_workers, Task on_start = nullptr)
+      : stopping(false) {
+    if (n_workers == 0) {
+      n_workers = 1;
+    }
+    workers.reserve(n_workers);
+    for (size_t i = 0; i < n_workers; i++) {
+      workers.emplace_back([this, i, on_start] {
+        if (on_start) {
+          on_start(i);
+        }
+        worker_loop(i);
+      });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    for (auto &worker : workers) {
+      if (worker.joinable()) {
+        worker.join();
+      }
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t size() const { return workers.size(); }
+
+  void submit(Task task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push_back(std::move(task));
+    }
+    cv.notify_one();
+  }
+
+private:
+  void worker_loop(size_t index) {
+    for (;;) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+        if (tasks.empty()) {
+          return; // остановка и очередь пуста
+        }
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      task(index);
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::deque<Task> tasks;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool stopping;
+};
+
+} // namespace muzloto
@@ -132,16 +132,52 @@ class MuzlotoScanner:
             image_path = sys.argv[2]
             operator = sys.argv[3] if len(sys.argv) > 3 else "Система"
             
-            scanner = MuzlotoScanner()
+            # Запущенный демон избавляет от загрузки моделей Tesseract
+            scanner = MuzlotoScanner(daemon=os.environ.get("MUZLOTO_DAEMON", ""))
             result = scanner.process_anketa(image_path, operator)
             print(f"Результат: {result}")
             
         elif command == "folder" and len(sys.argv) > 2:
-            folder_path = sys.argv[2]
-            operator = sys.argv[3] if len(sys.argv) > 3 else "Пакетная обработка"
+            # --split: все страницы TIFF и несколько анкет на одном снимке
+            args = [a for a in sys.argv[2:] if a != "--split"]
+            split_forms = len(args) < len(sys.argv) - 2
+            folder_path = args[0]
+            operator = args[1] if len(args) > 1 else "Пакетная обработка"
             
             scanner = MuzlotoScanner()
-            scanner.process_folder(folder_path, operator)
+            scanner.process_folder(folder_path, operator,
+                                   split_forms=split_forms)
+            
+        elif command == "watch" and len(sys.argv) > 2:
+            # --once: загрузить то, что есть, и выйти, не дожидаясь новых
+            args = [a for a in sys.argv[2:] if a != "--once"]
+            until_idle = len(args) < len(sys.argv) - 2
+            folder_path = args[0]
+            operator = args[1] if len(args) > 1 else "Наблюдение за папкой"
+            
+            # Кэш результатов: после сбоя анкеты незаписанного пакета не
+            # распознаются заново
+            scanner = MuzlotoScanner(
+                cache_dir=os.environ.get("MUZLOTO_CACHE", ".muzloto_cache"))
+            scanner.watch_folder(folder_path, operator, until_idle=until_idle)
+            
+        elif command == "daemon":
+            from python.daemon import serve
+            # --metrics host:port: HTTP /metrics для Prometheus
+            args = sys.argv[2:]
+            metrics_address = None
+            if "--metrics" in args:
+                index = args.index("--metrics")
+                if index + 1 >= len(args):
+                    print("Укажите адрес метрик: --metrics host:port")
+                    return
+                metrics_address = args[index + 1]
+                del args[index:index + 2]
+            # --allow-remote: слушать не только loopback (без авторизации!)
+            allow_remote = "--allow-remote" in args
+            args = [a for a in args if a != "--allow-remote"]
+            address = args[0] if args else None
+            serve(MuzlotoScanner(), address, metrics_address, allow_remote)
             
         elif command == "stats":
             scanner = MuzlotoScanner()
@@ -166,14 +202,25 @@ DocumentProcessor - система обработки анкет Muzloto
 
 Использование:
   python main.py scan <путь_к_анкете> [оператор]
-  python main.py folder <путь_к_папке> [оператор]
+  python main.py folder <путь_к_папке> [оператор] [--split]
+  python main.py watch <путь_к_папке> [оператор] [--once]
+                           - загружать новые сканы по мере появления
   python main.py stats
+  python main.py daemon [host:port] - держать движки OCR прогретыми
+                                      (по умолчанию 127.0.0.1:8765)
+        [--metrics host:port]       - и отдавать метрики на /metrics
+        [--allow-remote]            - разрешить адрес не на loopback:
+                                      сканер читает любые файлы машины
+                                      и не проверяет клиентов
   python main.py install   - автоматическая установка
   python main.py build     - сборка C++ библиотеки
 
 Примеры:
   python main.py scan scans/анкета.jpg "Иван Иванов"
   python main.py folder scans/ "Пакетная обработка"
+  python main.py watch inbox/ "Иван Иванов"  # Ctrl+C - остановить
+  python main.py daemon &    # затем scan отвечает за миллисекунды
+  python main.py daemon --metrics 9108 &  # метрики для Prometheus
   
 Файл результатов: анкеты_muzloto.xlsx
     """)
@@ -0,0 +1,226 @@
+"""
+Демон сканера Muzloto: держит прогретые движки Tesseract в памяти.
+
+Инициализация двух LSTM-моделей занимает секунды, а распознавание одной
+анкеты - меньше. Демон создаёт пул C++ сканеров один раз, а CLI и
+process_anketa отправляют ему пути к файлам и получают JSON результата.
+
+Протокол - JSON по строке на сообщение через TCP на localhost:
+    -> {"op": "scan", "path": "/abs/path/anketa.jpg"}
+    <- {"success": true, "date": "18.12", ...}
+    -> {"op": "ping"}      <- {"ok": true, "workers": 8, "settings": {...}}
+    -> {"op": "metrics"}   <- {"ok": true, "metrics": {...}}
+    -> {"op": "shutdown"}  <- {"ok": true}
+
+С metrics_address демон также отдаёт по HTTP GET /metrics те же метрики
+в формате OpenMetrics - для Prometheus, автомасштабирования и алертов.
+
+Демон читает любой файл, путь к которому пришёл в запросе, и не
+проверяет, кто спрашивает. Поэтому он слушает только loopback-адреса;
+другой адрес (например, 0.0.0.0) нужно разрешить явно (allow_remote,
+в CLI - --allow-remote), и тогда сканы доступны всем, кто видит порт.
+
+Демон распознаёт со своими настройками (settings в ответе на ping):
+профиль, схема, шаблон, проверка снимка, кэш. Клиент с другими
+настройками демоном не пользуется и сканирует локально - см.
+MuzlotoScanner(daemon=...).
+"""
+
+import ipaddress
+import json
+import os
+import socket
+import socketserver
+import threading
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from pathlib import Path
+from typing import Any, Dict, Optional, Tuple
+
+DEFAULT_HOST = "127.0.0.1"
+DEFAULT_PORT = 8765
+
+
+def parse_address(address: Optional[str] = None) -> Tuple[str, int]:
+    """Адрес "host:port" или "port"; по умолчанию - MUZLOTO_DAEMON или
+    127.0.0.1:8765."""
+    address = address or os.environ.get("MUZLOTO_DAEMON", "")
+    if not address:
+        return DEFAULT_HOST, DEFAULT_PORT
+    host, _, port = address.rpartition(":")
+    return host or DEFAULT_HOST, int(port)
+
+
+def is_loopback(host: str) -> bool:
+    """Все адреса host - loopback (127.0.0.0/8, ::1)."""
+    try:
+        infos = socket.getaddrinfo(host, None)
+    except socket.gaierror:
+        return False
+    return bool(infos) and all(
+        ipaddress.ip_address(info[4][0].split('%')[0]).is_loopback
+        for info in infos)
+
+
+def bind_address(address: Optional[str],
+                 allow_remote: bool) -> Tuple[str, int]:
+    """Адрес для прослушивания; не-loopback - только с allow_remote."""
+    host, port = parse_address(address)
+    if not is_loopback(host):
+        if not allow_remote:
+            raise ValueError(
+                f"Адрес {host} доступен из сети, а демон без авторизации "
+                f"читает любые локальные файлы. Используйте 127.0.0.1 или "
+                f"разрешите явно (--allow-remote)")
+        print(f"⚠ Демон слушает {host}: любой, кто видит порт {port}, "
+              f"может читать файлы этой машины через сканер")
+    return host, port
+
+
+class DaemonClient:
+    """Тонкий клиент демона. Каждый запрос - отдельное соединение, поэтому
+    клиент можно использовать из нескольких потоков."""
+
+    def __init__(self, address: Optional[str] = None,
+                 timeout: float = 120.0):
+        self.host, self.port = parse_address(address)
+        self.timeout = timeout
+
+    def _request(self, message: Dict[str, Any],
+                 timeout: Optional[float] = None) -> Dict[str, Any]:
+        with socket.create_connection(
+                (self.host, self.port),
+                timeout=self.timeout if timeout is None else timeout) as sock:
+            sock.sendall(json.dumps(message, ensure_ascii=False)
+                         .encode('utf-8') + b"\n")
+            with sock.makefile('rb') as reader:
+                line = reader.readline()
+        if not line:
+            raise ConnectionError("Демон закрыл соединение без ответа")
+        return json.loads(line.decode('utf-8'))
+
+    def ping(self) -> Optional[Dict[str, Any]]:
+        """Ответ демона на ping или None, если он не отвечает (короткий
+        таймаут - для выбора режима)."""
+        try:
+            response = self._request({"op": "ping"}, timeout=0.5)
+        except (OSError, ValueError):
+            return None
+        return response if response.get("ok", False) else None
+
+    def is_available(self) -> bool:
+        """Отвечает ли демон."""
+        return self.ping() is not None
+
+    def scan(self, image_path) -> Dict[str, Any]:
+        """Сканирует файл в демоне; путь передаётся абсолютным, так как
+        рабочий каталог демона может отличаться."""
+        return self._request({"op": "scan",
+                              "path": str(Path(image_path).resolve())})
+
+    def metrics(self) -> Dict[str, Any]:
+        """Метрики C++ ядра демона (JSON-снимок)."""
+        return self._request({"op": "metrics"})["metrics"]
+
+    def shutdown(self):
+        self._request({"op": "shutdown"})
+
+
+class _Handler(socketserver.StreamRequestHandler):
+    def handle(self):
+        for line in self.rfile:
+            try:
+                response = self.server.dispatch(json.loads(line))
+            except Exception as e:
+                response = {"success": False, "error_message": str(e)}
+            self.wfile.write(json.dumps(response, ensure_ascii=False)
+                             .encode('utf-8') + b"\n")
+            self.wfile.flush()
+
+
+class ScanDaemon(socketserver.ThreadingTCPServer):
+    """Сервер вокруг пула C++ сканеров. Запросы разных клиентов
+    распознаются параллельно рабочими потоками пула."""
+
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, scanner, address: Optional[str] = None,
+                 allow_remote: bool = False):
+        """
+        Args:
+            scanner: MuzlotoScanner с инициализированным C++ ядром
+            address: "host:port" для прослушивания
+            allow_remote: Разрешить адрес не на loopback
+        """
+        bind = bind_address(address, allow_remote)
+        self.scanner = scanner
+        self.scanner._ensure_pool()  # прогреваем все движки заранее
+        super().__init__(bind, _Handler)
+
+    def dispatch(self, message: Dict[str, Any]) -> Dict[str, Any]:
+        op = message.get("op")
+        if op == "scan":
+            return self.scanner._scan_batch([Path(message["path"])])[0]
+        if op == "ping":
+            return {"ok": True, "workers": self.scanner.workers,
+                    "settings": self.scanner.scan_settings()}
+        if op == "metrics":
+            return {"ok": True, "metrics": self.scanner.metrics()}
+        if op == "shutdown":
+            # shutdown() ждёт выхода из serve_forever - не из этого потока
+            threading.Thread(target=self.shutdown, daemon=True).start()
+            return {"ok": True}
+        raise ValueError(f"Неизвестная операция: {op}")
+
+
+class _MetricsHandler(BaseHTTPRequestHandler):
+    def do_GET(self):
+        if self.path.split("?")[0] != "/metrics":
+            self.send_error(404)
+            return
+        body = self.server.scanner.metrics("openmetrics").encode('utf-8')
+        self.send_response(200)
+        self.send_header("Content-Type", "application/openmetrics-text; "
+                         "version=1.0.0; charset=utf-8")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        pass  # опрос Prometheus раз в несколько секунд не пишем в консоль
+
+
+class MetricsServer(ThreadingHTTPServer):
+    """HTTP-эндпоинт /metrics рядом с демоном."""
+
+    daemon_threads = True
+    allow_reuse_address = True
+
+    def __init__(self, scanner, address: Optional[str] = None,
+                 allow_remote: bool = False):
+        bind = bind_address(address, allow_remote)
+        self.scanner = scanner
+        super().__init__(bind, _MetricsHandler)
+
+
+def serve(scanner, address: Optional[str] = None,
+          metrics_address: Optional[str] = None, allow_remote: bool = False):
+    """Запускает демон и обслуживает запросы до shutdown. Если задан
+    metrics_address, метрики отдаются по HTTP на http://host:port/metrics.
+    Адреса не на loopback - только с allow_remote."""
+    metrics = None
+    if metrics_address:
+        metrics = MetricsServer(scanner, metrics_address, allow_remote)
+        threading.Thread(target=metrics.serve_forever, daemon=True).start()
+        host, port = metrics.server_address[:2]
+        print(f"✓ Метрики: http://{host}:{port}/metrics")
+    try:
+        with ScanDaemon(scanner, address, allow_remote) as daemon:
+            host, port = daemon.server_address[:2]
+            print(f"✓ Демон сканера слушает {host}:{port} "
+                  f"({scanner.workers} движков)")
+            daemon.serve_forever()
+    finally:
+        if metrics is not None:
+            metrics.shutdown()
+            metrics.server_close()
@@ -9,8 +9,73 @@ import pandas as pd
 from openpyxl import load_workbook
 from openpyxl.styles import Font, PatternFill, Alignment, Border, Side
 import warnings
+from concurrent.futures import ThreadPoolExecutor
 warnings.filterwarnings('ignore')
 
+try:
+    from .daemon import DaemonClient
+except ImportError:
+    from daemon import DaemonClient
+
+class MuzlotoString(ctypes.Structure):
+    _fields_ = [("data", ctypes.c_void_p), ("length", ctypes.c_size_t)]
+
+    def text(self) -> str:
+        if not self.data:
+            return ""
+        return ctypes.string_at(self.data, self.length).decode('utf-8')
+
+
+class MuzlotoField(ctypes.Structure):
+    _fields_ = [
+        ("id", MuzlotoString),
+        ("value", MuzlotoString),
+        ("confidence", ctypes.c_float),
+    ]
+
+
+class MuzlotoResult(ctypes.Structure):
+    _fields_ = [
+        ("success", ctypes.c_int),
+        ("cache_hit", ctypes.c_int),
+        ("processing_time_ms", ctypes.c_double),
+        ("image_width", ctypes.c_int),
+        ("image_height", ctypes.c_int),
+        ("page", ctypes.c_int),
+        ("form", ctypes.c_int),
+        ("error_message", MuzlotoString),
+        ("error_code", MuzlotoString),
+        ("source", MuzlotoString),
+        ("raw_text", MuzlotoString),
+        ("field_count", ctypes.c_int),
+        ("fields", ctypes.POINTER(MuzlotoField)),
+    ]
+
+    def to_dict(self) -> Dict[str, Any]:
+        """Те же ключи, что и в JSON-результате сканирования."""
+        data = {
+            "success": bool(self.success),
+            "cache_hit": bool(self.cache_hit),
+            "processing_time_ms": self.processing_time_ms,
+            "image_width": self.image_width,
+            "image_height": self.image_height,
+            "source": self.source.text(),
+            "page": self.page,
+            "form": self.form,
+            "error_message": self.error_message.text(),
+            "error_code": self.error_code.text(),
+            "raw_text": self.raw_text.text(),
+            "confidences": {},
+        }
+        # Поля - в порядке схемы сканера, ключи из схемы
+        for i in range(self.field_count):
+            field = self.fields[i]
+            key = field.id.text()
+            data[key] = field.value.text()
+            data["confidences"][key] = field.confidence
+        return data
+
+
 class MuzlotoScanner:
     """Сканер анкет Muzloto с сохранением в один Excel файл."""
     
@@ -42,24 +107,153 @@ class MuzlotoScanner:
         "Комментарий"           # Дополнительные заметки
     ]
     
+    # Строк в одной записи журнала при пакетной обработке
+    JOURNAL_BATCH_ROWS = 64
+    
+    # Откуда C++ ядро берёт колонки журнала при загрузке папки
+    # (watch_folder): ключ поля схемы или служебный ключ "@..."; колонок
+    # "Оператор" и "Комментарий" здесь нет - это текст вызывающего
+    INGEST_COLUMN_KEYS = {
+        "Дата заполнения": "@time",
+        "Файл анкеты": "@file",
+        "Дата визита": "date",
+        "Номер столика": "table_number",
+        "Место игры": "location",
+        "Довольны посещением": "satisfaction_rating",
+        "Понравился плейлист": "playlist_rating",
+        "Треки для добавления": "tracks_to_add",
+        "Понравилась локация": "location_rating",
+        "Понравились кухня и бар": "kitchen_rating",
+        "Устроил сервис": "service_rating",
+        "Понравился ведущий": "host_rating",
+        "Количество посещений": "visits_count",
+        "Оценка стоимости": "ticket_price",
+        "Знают о заказе": "know_booking",
+        "Источник информации": "source_info",
+        "Цель посещения": "purpose",
+        "Предложения по улучшению": "improvements",
+        "Телефон": "phone_number",
+        "Статус обработки": "@status",
+        "Время обработки (мс)": "@time_ms",
+        "Сырой текст": "@raw_text",
+    }
+    
     def __init__(self, 
                  excel_file: str = "анкеты_muzloto.xlsx",
-                 tessdata_path: Optional[str] = None):
+                 tessdata_path: Optional[str] = None,
+                 workers: int = 0,
+                 profile: str = "quality",
+                 preprocess_backend: str = "cpu",
+                 schema_path: Optional[str] = None,
+                 template_path: Optional[str] = None,
+                 align_page: Optional[bool] = None,
+                 daemon: Optional[str] = None,
+                 cache_dir: Optional[str] = None,
+                 cache_size_mb: int = 256,
+                 journal_file: Optional[str] = None,
+                 quality_gate: str = "flag",
+                 two_pass: bool = False,
+                 fast_tessdata_path: Optional[str] = None,
+                 shared_engines: int = 0,
+                 engine_timeout_ms: int = -1):
         """
         Args:
             excel_file: Путь к ОБЩЕМУ файлу Excel
             tessdata_path: Путь к данным Tesseract
+            workers: Число потоков для пакетной обработки (0 - по числу ядер)
+            profile: Профиль предобработки: "quality" или "fast"
+                (быстрая бинаризация без шумоподавления для чистых сканов)
+            preprocess_backend: Устройство предобработки: "cpu",
+                "opencl", "cuda" или "auto"; недоступный ускоритель
+                заменяется на CPU
+            schema_path: JSON-схема анкеты: вопросы, ключи и типы полей
+                (например, data/schemas/muzloto_v1.json); по умолчанию -
+                встроенная схема muzloto_v1
+            template_path: JSON-шаблон анкеты (например,
+                data/templates/muzloto_v1.json) - OCR только областей
+                ответов; заменяет области из schema_path, если они там есть.
+                Поля шаблона должны быть в схеме
+            align_page: Выравнивать страницу перед распознаванием
+                (по умолчанию включено, если задан шаблон)
+            daemon: Адрес демона сканера ("host:port"). Если демон
+                отвечает, анкеты распознаются в нём, а локальное C++ ядро
+                инициализируется, только если демон станет недоступен.
+                Демон распознаёт со своими настройками; если они
+                расходятся с настройками этого сканера (см.
+                scan_settings), демон не используется
+            cache_dir: Каталог кэша результатов: повторно встреченные
+                изображения (по содержимому) не распознаются заново
+            cache_size_mb: Предельный размер кэша, МБ
+            journal_file: CSV-журнал, в который дописываются результаты
+                (по умолчанию рядом с Excel-файлом); Excel строится из него
+                через export_excel()
+            quality_gate: Проверка снимка перед OCR: "flag" - анкета
+                распознаётся, а причина (пустой, размытый снимок, нет
+                анкеты) попадает в error_code и в комментарий строки;
+                "reject" - такие снимки не распознаются; "off" - без
+                проверки. Пороги "reject" ещё не проверены на сканах из
+                photos/, поэтому по умолчанию - "flag"
+            two_pass: Двухпроходное распознавание: быстрый первый проход,
+                повторно - только поля с низкой уверенностью или
+                неправдоподобным значением
+            fast_tessdata_path: Каталог быстрых моделей (tessdata_fast)
+                для первого прохода; по умолчанию - основные модели
+            shared_engines: Если больше 0, одиночные сканы из разных
+                потоков идут через общий дескриптор с таким числом
+                движков вместо одного движка
+            engine_timeout_ms: Сколько ждать свободного движка общего
+                дескриптора (-1 - без ограничения); по истечении скан
+                возвращает ошибку с error_code "busy"
         """
         self.excel_file = Path(excel_file)
+        self.journal_file = (Path(journal_file) if journal_file
+                             else self.excel_file.with_suffix('.csv'))
         self.tessdata_path = tessdata_path
+        self.profile = profile
+        self.preprocess_backend = preprocess_backend
+        self.schema_path = schema_path
+        self.template_path = template_path
+        self.align_page = (template_path is not None
+                           if align_page is None else align_page)
+        self.workers = workers if workers > 0 else (os.cpu_count() or 1)
+        self.cache_dir = cache_dir
+        self.cache_size_mb = cache_size_mb
+        self.quality_gate = quality_gate
+        self.two_pass = two_pass
+        self.fast_tessdata_path = fast_tessdata_path
+        self.shared_engines = shared_engines
+        self.engine_timeout_ms = engine_timeout_ms
         
-        # Загружаем C++ библиотеку
-        self.lib = self._load_core_library()
+        self.lib = None
         self.scanner_ptr = None
+        self.pool_ptr = None
+        self.sink_ptr = None
+        self._pending_rows: List[Dict[str, Any]] = []
+        
+        # С прогретым демоном не тратим секунды на загрузку моделей. Демон
+        # распознаёт со своими настройками, поэтому при расхождении
+        # сканируем локально
+        self.daemon = None
+        if daemon is not None:
+            client = DaemonClient(daemon)
+            info = client.ping()
+            if info is not None:
+                remote = info.get("settings", {})
+                mismatch = [key for key, value in self.scan_settings().items()
+                            if remote.get(key) != value]
+                if mismatch:
+                    print(f"⚠ Демон {client.host}:{client.port} запущен с "
+                          f"другими настройками ({', '.join(mismatch)}), "
+                          f"сканирую локально")
+                else:
+                    self.daemon = client
+                    print(f"✓ Подключен демон сканера "
+                          f"{client.host}:{client.port}")
         
         # Инициализация
-        self._init_scanner()
-        self._ensure_excel_file()
+        if self.daemon is None:
+            self._ensure_engine()
+        self._ensure_sink()
         
         # Статистика
         self.stats = {
@@ -70,8 +264,42 @@ class MuzlotoScanner:
         }
         
         print(f"✓ Сканер Muzloto инициализирован")
+        print(f"  Журнал результатов: {self.journal_file}")
         print(f"  Файл для сохранения: {self.excel_file}")
     
+    def scan_settings(self) -> Dict[str, Any]:
+        """Настройки, от которых зависит результат распознавания; демон
+        сообщает свои клиентам, и те проверяют совпадение."""
+        def resolved(path):
+            return str(Path(path).resolve()) if path else None
+        
+        return {
+            "profile": self.profile,
+            "preprocess_backend": self.preprocess_backend,
+            "schema_path": resolved(self.schema_path),
+            "template_path": resolved(self.template_path),
+            "align_page": self.align_page,
+            "quality_gate": self.quality_gate,
+            "two_pass": self.two_pass,
+            "tessdata_path": resolved(self.tessdata_path),
+            "fast_tessdata_path": resolved(self.fast_tessdata_path),
+            "cache_dir": resolved(self.cache_dir),
+        }
+    
+    def _ensure_engine(self):
+        """Загружает C++ библиотеку и инициализирует сканер при первом
+        обращении."""
+        if self.scanner_ptr is None:
+            self._ensure_library()
+            self._init_scanner()
+    
+    def _ensure_library(self):
+        """Загружает C++ библиотеку без моделей Tesseract - журналу
+        результатов нужна только она."""
+        if self.lib is None:
+            self.lib = self._load_core_library()
+        return self.lib
+    
     def _load_core_library(self):
         """Загружает скомпилированную C++ библиотеку."""
         # Определяем путь к библиотеке в зависимости от ОС
@@ -115,6 +343,14 @@ class MuzlotoScanner:
         self.lib.muzloto_create.restype = ctypes.c_void_p
         self.lib.muzloto_create.argtypes = []
 
+        self.lib.muzloto_create_pooled.restype = ctypes.c_void_p
+        self.lib.muzloto_create_pooled.argtypes = [ctypes.c_int]
+
+        self.lib.muzloto_set_lease_timeout.argtypes = [
+            ctypes.c_void_p, ctypes.c_int
+        ]
+        self.lib.muzloto_set_lease_timeout.restype = None
+
         self.lib.muzloto_destroy.argtypes = [ctypes.c_void_p]
         self.lib.muzloto_destroy.restype = None
 
@@ -128,11 +364,144 @@ class MuzlotoScanner:
         ]
         self.lib.muzloto_scan_image.restype = ctypes.c_void_p   # ← важно
 
+        # Сканирование из памяти: закодированный файл и готовые пиксели
+        self.lib.muzloto_scan_buffer.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t
+        ]
+        self.lib.muzloto_scan_buffer.restype = ctypes.c_void_p
+
+        self.lib.muzloto_scan_pixels.argtypes = [
+            ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int, ctypes.c_int,
+            ctypes.c_int, ctypes.c_size_t
+        ]
+        self.lib.muzloto_scan_pixels.restype = ctypes.c_void_p
+
         self.lib.muzloto_free_string.argtypes = [ctypes.c_void_p]  # ← важно
         self.lib.muzloto_free_string.restype = None
+        
+        # Результат структурой: без сериализации JSON на горячем пути
+        self.lib.muzloto_scan_image_result.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p
+        ]
+        self.lib.muzloto_scan_image_result.restype = ctypes.POINTER(
+            MuzlotoResult)
+        
+        self.lib.muzloto_scan_batch_results.argtypes = [
+            ctypes.c_void_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int
+        ]
+        self.lib.muzloto_scan_batch_results.restype = ctypes.POINTER(
+            MuzlotoResult)
+        
+        self.lib.muzloto_scan_documents_results.argtypes = [
+            ctypes.c_void_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int,
+            ctypes.POINTER(ctypes.c_int)
+        ]
+        self.lib.muzloto_scan_documents_results.restype = ctypes.POINTER(
+            MuzlotoResult)
+        
+        self.lib.muzloto_free_result.argtypes = [ctypes.POINTER(MuzlotoResult)]
+        self.lib.muzloto_free_result.restype = None
+
+        # Пакетное сканирование пулом потоков
+        self.lib.muzloto_pool_create.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        self.lib.muzloto_pool_create.restype = ctypes.c_void_p
+
+        self.lib.muzloto_pool_destroy.argtypes = [ctypes.c_void_p]
+        self.lib.muzloto_pool_destroy.restype = None
+
+        self.lib.muzloto_scan_batch.argtypes = [
+            ctypes.c_void_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int
+        ]
+        self.lib.muzloto_scan_batch.restype = ctypes.c_void_p
+
+        # Асинхронное сканирование через пул
+        self.lib.muzloto_submit.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p, ctypes.c_int64
+        ]
+        self.lib.muzloto_submit.restype = ctypes.c_int
+
+        self.lib.muzloto_poll.argtypes = [
+            ctypes.c_void_p, ctypes.POINTER(ctypes.c_int64)
+        ]
+        self.lib.muzloto_poll.restype = ctypes.c_void_p
+
+        self.lib.muzloto_wait.argtypes = [
+            ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(ctypes.c_int64)
+        ]
+        self.lib.muzloto_wait.restype = ctypes.c_void_p
 
-        # Создаем сканер
-        self.scanner_ptr = self.lib.muzloto_create()
+        self.lib.muzloto_pending.argtypes = [ctypes.c_void_p]
+        self.lib.muzloto_pending.restype = ctypes.c_int
+
+        # Загрузка папки по мере поступления сканов
+        self.lib.muzloto_ingest_open.argtypes = [
+            ctypes.c_void_p, ctypes.c_void_p, ctypes.c_char_p,
+            ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int,
+            ctypes.c_int
+        ]
+        self.lib.muzloto_ingest_open.restype = ctypes.c_void_p
+
+        self.lib.muzloto_ingest_step.argtypes = [ctypes.c_void_p, ctypes.c_int]
+        self.lib.muzloto_ingest_step.restype = ctypes.c_void_p
+
+        self.lib.muzloto_ingest_close.argtypes = [ctypes.c_void_p]
+        self.lib.muzloto_ingest_close.restype = None
+
+        self.lib.muzloto_set_preprocess_profile.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p
+        ]
+        self.lib.muzloto_set_preprocess_profile.restype = ctypes.c_int
+
+        self.lib.muzloto_set_preprocess_backend.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p
+        ]
+        self.lib.muzloto_set_preprocess_backend.restype = ctypes.c_int
+
+        self.lib.muzloto_preprocess_backend.argtypes = [ctypes.c_void_p]
+        self.lib.muzloto_preprocess_backend.restype = ctypes.c_char_p
+
+        self.lib.muzloto_set_quality_gate.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p
+        ]
+        self.lib.muzloto_set_quality_gate.restype = ctypes.c_int
+
+        self.lib.muzloto_set_two_pass.argtypes = [
+            ctypes.c_void_p, ctypes.c_int, ctypes.c_char_p
+        ]
+        self.lib.muzloto_set_two_pass.restype = None
+        
+        self.lib.muzloto_load_schema.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p
+        ]
+        self.lib.muzloto_load_schema.restype = ctypes.c_int
+        
+        self.lib.muzloto_load_template.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p
+        ]
+        self.lib.muzloto_load_template.restype = ctypes.c_int
+
+        self.lib.muzloto_set_alignment.argtypes = [
+            ctypes.c_void_p, ctypes.c_int, ctypes.c_int, ctypes.c_int
+        ]
+        self.lib.muzloto_set_alignment.restype = None
+
+        self.lib.muzloto_set_result_cache.argtypes = [
+            ctypes.c_void_p, ctypes.c_char_p, ctypes.c_size_t
+        ]
+        self.lib.muzloto_set_result_cache.restype = ctypes.c_int
+
+        self.lib.muzloto_clear_result_cache.argtypes = [ctypes.c_void_p]
+        self.lib.muzloto_clear_result_cache.restype = None
+
+        # Создаем сканер; общий дескриптор можно вызывать из нескольких
+        # потоков сразу
+        if self.shared_engines > 0:
+            self.scanner_ptr = self.lib.muzloto_create_pooled(
+                self.shared_engines)
+            self.lib.muzloto_set_lease_timeout(
+                self.scanner_ptr, self.engine_timeout_ms)
+        else:
+            self.scanner_ptr = self.lib.muzloto_create()
         
         # Инициализируем с данными Tesseract
         tessdata = None
@@ -142,50 +511,144 @@ class MuzlotoScanner:
         result = self.lib.muzloto_initialize(self.scanner_ptr, tessdata)
         if result != 1:
             raise RuntimeError("Не удалось инициализировать C++ сканер")
+        
+        if not self.lib.muzloto_set_preprocess_profile(
+                self.scanner_ptr, self.profile.encode('utf-8')):
+            raise ValueError(f"Неизвестный профиль предобработки: {self.profile}")
+        
+        if not self.lib.muzloto_set_preprocess_backend(
+                self.scanner_ptr, self.preprocess_backend.encode('utf-8')):
+            raise ValueError(
+                f"Неизвестное устройство предобработки: "
+                f"{self.preprocess_backend}")
+        backend = self.lib.muzloto_preprocess_backend(
+            self.scanner_ptr).decode('utf-8')
+        if self.preprocess_backend not in ("cpu", "auto", backend):
+            print(f"⚠️ {self.preprocess_backend} недоступен, "
+                  f"предобработка на {backend}")
+        
+        if not self.lib.muzloto_set_quality_gate(
+                self.scanner_ptr, self.quality_gate.encode('utf-8')):
+            raise ValueError(
+                f"Неизвестный режим проверки снимка: {self.quality_gate}")
+        
+        if self.two_pass:
+            self.lib.muzloto_set_two_pass(
+                self.scanner_ptr, 1,
+                self.fast_tessdata_path.encode('utf-8')
+                if self.fast_tessdata_path else None)
+        
+        # Шаблон сохраняется при смене схемы и проверяется по её полям, так
+        # что порядок не важен; схема первой - чтобы и шаблон проверялся
+        # сразу по ней
+        if self.schema_path:
+            if not self.lib.muzloto_load_schema(
+                    self.scanner_ptr, str(self.schema_path).encode('utf-8')):
+                raise RuntimeError(
+                    f"Не удалось загрузить схему анкеты: {self.schema_path}")
+        
+        if self.template_path:
+            if not self.lib.muzloto_load_template(
+                    self.scanner_ptr, str(self.template_path).encode('utf-8')):
+                raise RuntimeError(
+                    f"Не удалось загрузить шаблон анкеты: {self.template_path}")
+        
+        self.lib.muzloto_set_alignment(
+            self.scanner_ptr, 1 if self.align_page else 0, 0, 0)
+        
+        if self.cache_dir:
+            if not self.lib.muzloto_set_result_cache(
+                    self.scanner_ptr, str(self.cache_dir).encode('utf-8'),
+                    self.cache_size_mb * 1024 * 1024):
+                raise RuntimeError(
+                    f"Не удалось открыть кэш результатов: {self.cache_dir}")
     
-    def _ensure_excel_file(self):
-        """Создает или проверяет Excel файл с правильными колонками."""
-        if not self.excel_file.exists():
-            print(f"Создаю новый файл для анкет: {self.excel_file}")
-            
-            # Создаем DataFrame с нужными колонками
-            df = pd.DataFrame(columns=self.FIELD_NAMES)
-            
-            # Сохраняем
-            with pd.ExcelWriter(self.excel_file, engine='openpyxl') as writer:
-                df.to_excel(writer, index=False, sheet_name='Анкеты')
-            
-            # Форматируем файл
-            self._format_excel_file()
-            
-        else:
-            # Проверяем, что файл имеет правильные колонки
+    def _ensure_sink(self):
+        """Открывает CSV-журнал результатов в C++ ядре. Старый Excel без
+        журнала переносится в журнал один раз."""
+        if self.sink_ptr is not None:
+            return self.sink_ptr
+        
+        lib = self._ensure_library()
+        lib.muzloto_sink_open.argtypes = [
+            ctypes.c_char_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int
+        ]
+        lib.muzloto_sink_open.restype = ctypes.c_void_p
+        
+        lib.muzloto_sink_append.argtypes = [
+            ctypes.c_void_p, ctypes.POINTER(ctypes.c_char_p), ctypes.c_int
+        ]
+        lib.muzloto_sink_append.restype = ctypes.c_int
+        
+        lib.muzloto_sink_rows.argtypes = [ctypes.c_void_p]
+        lib.muzloto_sink_rows.restype = ctypes.c_int64
+        
+        lib.muzloto_sink_close.argtypes = [ctypes.c_void_p]
+        lib.muzloto_sink_close.restype = None
+        
+        migrate = not self.journal_file.exists() and self.excel_file.exists()
+        
+        encoded = [name.encode('utf-8') for name in self.FIELD_NAMES]
+        columns = (ctypes.c_char_p * len(encoded))(*encoded)
+        self.sink_ptr = lib.muzloto_sink_open(
+            str(self.journal_file).encode('utf-8'), columns, len(encoded))
+        if not self.sink_ptr:
+            raise RuntimeError(
+                f"Не удалось открыть журнал результатов: {self.journal_file}")
+        
+        if migrate:
             try:
-                df = pd.read_excel(self.excel_file, sheet_name=0)
-                existing_columns = list(df.columns)
-                
-                # Если колонки не совпадают, добавляем недостающие
-                missing_columns = [col for col in self.FIELD_NAMES 
-                                 if col not in existing_columns]
-                
-                if missing_columns:
-                    print(f"Добавляю недостающие колонки: {missing_columns}")
-                    
-                    for col in missing_columns:
-                        df[col] = ""
-                    
-                    # Сохраняем с новыми колонками
-                    with pd.ExcelWriter(self.excel_file, engine='openpyxl', 
-                                      mode='a', if_sheet_exists='replace') as writer:
-                        df.to_excel(writer, index=False, sheet_name='Анкеты')
-                    
-                    self._format_excel_file()
-                    
+                df = pd.read_excel(self.excel_file, sheet_name=0, dtype=str)
+                df = df.reindex(columns=self.FIELD_NAMES).fillna("")
+                self._pending_rows.extend(df.to_dict('records'))
+                self._flush_rows()
+                print(f"Перенесено строк из {self.excel_file}: {len(df)}")
             except Exception as e:
-                print(f"Ошибка проверки файла Excel: {e}")
-                # Создаем заново
-                self.excel_file.unlink(missing_ok=True)
-                self._ensure_excel_file()
+                print(f"⚠ Не удалось перенести {self.excel_file}: {e}")
+        return self.sink_ptr
+    
+    def _queue_row(self, row_data: Dict[str, Any]) -> int:
+        """Откладывает строку до _flush_rows и возвращает номер, который
+        она получит в Excel (с 1, после заголовка)."""
+        self._ensure_sink()
+        self._pending_rows.append(row_data)
+        return (self.lib.muzloto_sink_rows(self.sink_ptr)
+                + len(self._pending_rows) + 1)
+    
+    def _flush_rows(self):
+        """Дописывает отложенные строки в журнал одной записью."""
+        if not self._pending_rows:
+            return
+        
+        cells = []
+        for row in self._pending_rows:
+            for name in self.FIELD_NAMES:
+                value = row.get(name, "")
+                cells.append(b"" if value is None
+                             else str(value).encode('utf-8'))
+        cells_array = (ctypes.c_char_p * len(cells))(*cells)
+        
+        if not self.lib.muzloto_sink_append(self.sink_ptr, cells_array,
+                                            len(self._pending_rows)):
+            raise RuntimeError(
+                f"Не удалось записать в журнал: {self.journal_file}")
+        self._pending_rows.clear()
+    
+    def export_excel(self) -> Path:
+        """Строит оформленный Excel-файл из журнала целиком. Вызывается
+        один раз после пакета, а не на каждую анкету."""
+        self._flush_rows()
+        
+        df = pd.read_csv(self.journal_file, encoding='utf-8-sig', dtype=str,
+                         keep_default_na=False)
+        df = df.reindex(columns=self.FIELD_NAMES, fill_value="")
+        df["Время обработки (мс)"] = pd.to_numeric(
+            df["Время обработки (мс)"], errors='coerce')
+        
+        with pd.ExcelWriter(self.excel_file, engine='openpyxl') as writer:
+            df.to_excel(writer, index=False, sheet_name='Анкеты')
+        self._format_excel_file()
+        return self.excel_file
     
     def _format_excel_file(self):
         """Форматирует Excel файл для лучшего вида."""
@@ -267,7 +730,9 @@ class MuzlotoScanner:
     def process_anketa(self, 
                       image_path: str,
                       operator: str = "Система",
-                      comment: str = "") -> Dict[str, Any]:
+                      comment: str = "",
+                      scan_data: Optional[Dict[str, Any]] = None,
+                      export: bool = True) -> Dict[str, Any]:
         """
         Обрабатывает одну анкету и добавляет в общий Excel файл.
         
@@ -275,6 +740,10 @@ class MuzlotoScanner:
             image_path: Путь к изображению анкеты
             operator: Имя оператора/пользователя
             comment: Дополнительный комментарий
+            scan_data: Готовый результат сканирования (из пакетного режима);
+                если не передан, изображение сканируется сейчас
+            export: Сразу записать строку в журнал и обновить Excel.
+                Пакетный режим передаёт False и пишет строки пачками
             
         Returns:
             Результат обработки
@@ -298,24 +767,13 @@ class MuzlotoScanner:
             
             print(f"\n📄 Обработка: {image_path_obj.name}")
             
-            # Вызываем C++ ядро для распознавания
-            scan_start = datetime.now()
-            
-            image_path_bytes = str(image_path_obj).encode('utf-8')
-            json_str_ptr = self.lib.muzloto_scan_image(
-                self.scanner_ptr, image_path_bytes
-            )
-            
-            if not json_str_ptr:
-                raise RuntimeError("C++ сканер вернул пустой результат")
-            
-            # Парсим JSON результат
-            json_str = ctypes.string_at(json_str_ptr).decode('utf-8')
-            self.lib.muzloto_free_string(json_str_ptr)
-            
-            scan_data = json.loads(json_str)
-            
-            scan_time = (datetime.now() - scan_start).total_seconds() * 1000
+            if scan_data is None:
+                # Вызываем C++ ядро для распознавания
+                scan_start = datetime.now()
+                scan_data = self._scan_image(image_path_obj)
+                scan_time = (datetime.now() - scan_start).total_seconds() * 1000
+            else:
+                scan_time = scan_data.get("processing_time_ms", 0.0)
             
             if not scan_data.get("success", False):
                 error_msg = scan_data.get("error_message", "Неизвестная ошибка")
@@ -330,8 +788,8 @@ class MuzlotoScanner:
                 processing_time_ms=scan_time
             )
             
-            # Добавляем в Excel
-            row_num = self._append_to_excel(excel_row)
+            # Строка попадёт в журнал вместе с остальными строками пакета
+            row_num = self._queue_row(excel_row)
             
             # Обновляем статистику
             self.stats["success"] += 1
@@ -359,10 +817,164 @@ class MuzlotoScanner:
                 error=str(e),
                 operator=operator
             )
-            self._append_to_excel(error_row)
+            self._queue_row(error_row)
         
+        if export:
+            self.export_excel()
         return result
     
+    def _take_json(self, json_str_ptr) -> Any:
+        """Разбирает JSON-строку из C++ ядра и освобождает её."""
+        if not json_str_ptr:
+            raise RuntimeError("C++ сканер вернул пустой результат")
+        
+        json_str = ctypes.string_at(json_str_ptr).decode('utf-8')
+        self.lib.muzloto_free_string(json_str_ptr)
+        
+        return json.loads(json_str)
+    
+    def _take_results(self, results_ptr, count: int) -> List[Dict[str, Any]]:
+        """Переводит массив MuzlotoResult в словари и освобождает блок."""
+        if not results_ptr:
+            raise RuntimeError("C++ сканер вернул пустой результат")
+        try:
+            return [results_ptr[i].to_dict() for i in range(count)]
+        finally:
+            self.lib.muzloto_free_result(results_ptr)
+    
+    def _scan_image(self, image_path: Path) -> Dict[str, Any]:
+        """Сканирует одно изображение в демоне или в C++ ядре."""
+        if self.daemon is not None:
+            try:
+                return self.daemon.scan(image_path)
+            except (OSError, ValueError) as e:
+                print(f"⚠ Демон недоступен, сканирую локально: {e}")
+                self.daemon = None
+        
+        self._ensure_engine()
+        image_path_bytes = str(image_path).encode('utf-8')
+        return self._take_results(self.lib.muzloto_scan_image_result(
+            self.scanner_ptr, image_path_bytes
+        ), 1)[0]
+    
+    def scan_bytes(self, data: bytes) -> Dict[str, Any]:
+        """Сканирует закодированное изображение (JPEG, PNG...) без
+        временного файла - например, тело HTTP-запроса."""
+        self._ensure_engine()
+        return self._take_json(self.lib.muzloto_scan_buffer(
+            self.scanner_ptr, data, len(data)
+        ))
+    
+    def scan_array(self, image) -> Dict[str, Any]:
+        """Сканирует уже декодированное изображение numpy (uint8, серое
+        HxW или BGR/BGRA HxWxC) без копирования пикселей."""
+        import numpy as np
+        
+        self._ensure_engine()
+        if image.dtype != np.uint8:
+            raise ValueError("Ожидается изображение uint8")
+        if image.ndim == 2:
+            channels = 1
+        elif image.ndim == 3:
+            channels = image.shape[2]
+        else:
+            raise ValueError(f"Неподдерживаемая форма изображения: {image.shape}")
+        
+        # Строки могут идти с шагом, но пиксели внутри строки - подряд
+        if image.strides[-1] != 1 or (channels > 1 and image.strides[1] != channels):
+            image = np.ascontiguousarray(image)
+        
+        return self._take_json(self.lib.muzloto_scan_pixels(
+            self.scanner_ptr, image.ctypes.data, image.shape[1],
+            image.shape[0], channels, image.strides[0]
+        ))
+    
+    def metrics(self, fmt: str = "json"):
+        """Снимок метрик C++ ядра на весь процесс: сканы, отказы по
+        причинам, гистограммы этапов, очереди и загрузка пулов, кэш,
+        память движков. dict для "json", текст для "openmetrics"
+        (формат Prometheus)."""
+        lib = self._ensure_library()
+        lib.muzloto_metrics_snapshot.argtypes = [ctypes.c_char_p]
+        lib.muzloto_metrics_snapshot.restype = ctypes.c_void_p
+        lib.muzloto_free_string.argtypes = [ctypes.c_void_p]
+        lib.muzloto_free_string.restype = None
+        
+        snapshot_ptr = lib.muzloto_metrics_snapshot(fmt.encode('utf-8'))
+        if not snapshot_ptr:
+            raise ValueError(f"Неизвестный формат метрик: {fmt}")
+        try:
+            text = ctypes.string_at(snapshot_ptr).decode('utf-8')
+        finally:
+            lib.muzloto_free_string(snapshot_ptr)
+        return json.loads(text) if fmt == "json" else text
+    
+    def clear_cache(self):
+        """Удаляет все записи кэша результатов."""
+        if self.scanner_ptr is not None:
+            self.lib.muzloto_clear_result_cache(self.scanner_ptr)
+    
+    def _ensure_pool(self):
+        """Создаёт пул C++ сканеров при первом обращении."""
+        self._ensure_engine()
+        if self.pool_ptr is None:
+            self.pool_ptr = self.lib.muzloto_pool_create(
+                self.scanner_ptr, self.workers
+            )
+            if not self.pool_ptr:
+                raise RuntimeError("Не удалось создать пул C++ сканеров")
+        return self.pool_ptr
+    
+    def _scan_batch(self, image_paths: List[Path]) -> List[Dict[str, Any]]:
+        """Сканирует пачку изображений параллельно пулом C++ сканеров."""
+        self._ensure_pool()
+        
+        encoded = [str(p).encode('utf-8') for p in image_paths]
+        paths_array = (ctypes.c_char_p * len(encoded))(*encoded)
+        
+        return self._take_results(self.lib.muzloto_scan_batch_results(
+            self.pool_ptr, paths_array, len(encoded)
+        ), len(encoded))
+    
+    def scan_documents(self, image_paths: List[Path]) -> List[Dict[str, Any]]:
+        """Сканирует многостраничные TIFF и снимки с несколькими анкетами:
+        по результату на каждую анкету каждой страницы ("source", "page",
+        "form"), все анкеты распознаются пулом параллельно."""
+        self._ensure_pool()
+        
+        encoded = [str(p).encode('utf-8') for p in image_paths]
+        paths_array = (ctypes.c_char_p * len(encoded))(*encoded)
+        count = ctypes.c_int(0)
+        results_ptr = self.lib.muzloto_scan_documents_results(
+            self.pool_ptr, paths_array, len(encoded), ctypes.byref(count))
+        return self._take_results(results_ptr, count.value)
+    
+    def submit(self, image_path: Path, tag: int):
+        """Ставит изображение в очередь пула и сразу возвращается. Когда
+        очередь полна, ждёт, пока рабочий поток освободится."""
+        pool = self._ensure_pool()
+        if not self.lib.muzloto_submit(pool, str(image_path).encode('utf-8'),
+                                       tag):
+            raise RuntimeError(f"Не удалось поставить в очередь: {image_path}")
+    
+    def poll(self, timeout_ms: Optional[int] = 0):
+        """Готовый результат асинхронного сканирования: (tag, scan_data)
+        или None. timeout_ms=0 - не ждать, None - ждать без ограничения."""
+        if self.pool_ptr is None:
+            return None
+        
+        tag = ctypes.c_int64(0)
+        if timeout_ms == 0:
+            json_str_ptr = self.lib.muzloto_poll(self.pool_ptr,
+                                                 ctypes.byref(tag))
+        else:
+            json_str_ptr = self.lib.muzloto_wait(
+                self.pool_ptr, -1 if timeout_ms is None else timeout_ms,
+                ctypes.byref(tag))
+        if not json_str_ptr:
+            return None
+        return tag.value, self._take_json(json_str_ptr)
+    
     def _prepare_excel_row(self, scan_data: Dict, image_path: Path,
                       operator: str, comment: str, 
                       processing_time_ms: float) -> Dict[str, Any]:
@@ -370,6 +982,13 @@ class MuzlotoScanner:
         raw_text = scan_data.get('raw_text', '')
         if len(raw_text) > 500:
             raw_text = raw_text[:500] + "..."
+        
+        # Проверка снимка в режиме "flag": анкета распознана, но снимок
+        # сомнительный - причина остаётся в строке
+        quality_reason = scan_data.get('error_code', '')
+        if quality_reason:
+            comment = (f"{comment}; " if comment else "") + \
+                f"снимок: {quality_reason}"
     
         return {
             "Дата заполнения": datetime.now().strftime("%d.%m.%Y %H:%M"),
@@ -431,52 +1050,11 @@ class MuzlotoScanner:
             "Комментарий": "Ошибка обработки"
         }
     
-    def _append_to_excel(self, row_data: Dict[str, Any]) -> int:
-        """Добавляет строку в Excel файл и возвращает номер строки."""
-        try:
-            # Загружаем существующие данные
-            df = pd.read_excel(self.excel_file, sheet_name=0)
-            
-            # Создаем DataFrame из новой строки
-            new_row_df = pd.DataFrame([row_data])
-            
-            # Объединяем
-            df = pd.concat([df, new_row_df], ignore_index=True)
-            
-            # Сохраняем обратно в Excel
-            with pd.ExcelWriter(self.excel_file, engine='openpyxl', 
-                              mode='w') as writer:
-                df.to_excel(writer, index=False, sheet_name='Анкеты')
-            
-            # Возвращаем номер строки (Excel считает с 1, + заголовок)
-            return len(df) + 1
-            
-        except Exception as e:
-            print(f"Ошибка при сохранении в Excel: {e}")
-            
-            # Пробуем альтернативный метод через openpyxl
-            try:
-                wb = load_workbook(self.excel_file)
-                ws = wb.active
-                
-                # Находим первую пустую строку
-                next_row = ws.max_row + 1
-                
-                # Заполняем ячейки
-                for i, field_name in enumerate(self.FIELD_NAMES, 1):
-                    value = row_data.get(field_name, "")
-                    ws.cell(row=next_row, column=i, value=value)
-                
-                wb.save(self.excel_file)
-                return next_row
-                
-            except Exception as e2:
-                raise RuntimeError(f"Не удалось сохранить в Excel: {e2}")
-    
     def process_folder(self, 
                       folder_path: str,
                       operator: str = "Система",
-                      file_patterns: List[str] = None) -> Dict[str, Any]:
+                      file_patterns: List[str] = None,
+                      split_forms: bool = False) -> Dict[str, Any]:
         """
         Обрабатывает все анкеты в папке.
         
@@ -484,6 +1062,8 @@ class MuzlotoScanner:
             folder_path: Путь к папке со сканами
             operator: Имя оператора
             file_patterns: Шаблоны файлов (по умолчанию: *.jpg, *.png, *.jpeg)
+            split_forms: Читать все страницы многостраничных TIFF и искать
+                несколько анкет на одном снимке (строка на каждую анкету)
             
         Returns:
             Статистика обработки
@@ -497,7 +1077,8 @@ class MuzlotoScanner:
             }
         
         if file_patterns is None:
-            file_patterns = ["*.jpg", "*.png", "*.jpeg", "*.tiff", "*.bmp"]
+            file_patterns = ["*.jpg", "*.png", "*.jpeg", "*.tiff", "*.tif",
+                             "*.bmp"]
         
         # Находим все файлы
         files = []
@@ -523,13 +1104,36 @@ class MuzlotoScanner:
             "details": []
         }
         
-        for i, file_path in enumerate(files, 1):
-            print(f"\n[{i}/{len(files)}] Обработка: {file_path.name}")
+        # Файлы отправляются в пул асинхронно: пока ядро распознаёт
+        # следующие анкеты, готовые результаты пачками пишутся в журнал.
+        # Очередь пула ограничена, поэтому submit() сам притормаживает,
+        # если запись отстаёт.
+        use_pool = False
+        if self.daemon is None:
+            try:
+                self._ensure_pool()
+                use_pool = True
+            except Exception as e:
+                print(f"⚠ Асинхронное сканирование недоступно: {e}")
+        
+        details: Dict[int, Dict[str, Any]] = {}
+        
+        def handle(index: int, scan_data: Optional[Dict[str, Any]],
+                   file_path: Optional[Path] = None):
+            if file_path is None:
+                file_path = files[index - 1]
+                print(f"\n[{index}/{len(files)}] Обработка: {file_path.name}")
+            else:
+                print(f"\n[{index}] Обработка: {file_path.name}, "
+                      f"стр. {scan_data.get('page', 0) + 1}, "
+                      f"анкета {scan_data.get('form', 0) + 1}")
             
             result = self.process_anketa(
                 image_path=str(file_path),
                 operator=operator,
-                comment=f"Пакетная обработка #{i}"
+                comment=f"Пакетная обработка #{index}",
+                scan_data=scan_data,
+                export=False
             )
             
             if result["success"]:
@@ -537,16 +1141,65 @@ class MuzlotoScanner:
             else:
                 results["failed"] += 1
             
-            results["details"].append({
+            details[index] = {
                 "file": file_path.name,
                 "success": result["success"],
                 "message": result["message"],
                 "row": result.get("row_number")
-            })
+            }
+            
+            if len(self._pending_rows) >= self.JOURNAL_BATCH_ROWS:
+                self._flush_rows()
+        
+        if self.daemon is not None:
+            # Демон распознаёт параллельно своим пулом; ответы, которые не
+            # пришли, process_anketa досканирует локально
+            def scan_remote(path: Path) -> Optional[Dict[str, Any]]:
+                try:
+                    return self.daemon.scan(path)
+                except (OSError, ValueError):
+                    return None
             
-            # Небольшая пауза между обработкой файлов
-            import time
-            time.sleep(0.1)
+            with ThreadPoolExecutor(max_workers=self.workers) as executor:
+                futures = [executor.submit(scan_remote, f) for f in files]
+                for i, future in enumerate(futures, 1):
+                    handle(i, future.result())
+            files_to_submit = []
+        elif split_forms and use_pool:
+            # Каждая страница и каждая анкета на снимке - отдельная строка;
+            # анкеты всех файлов пачки распознаются одновременно
+            index = 0
+            for start in range(0, len(files), self.workers):
+                chunk = files[start:start + self.workers]
+                for scan_data in self.scan_documents(chunk):
+                    index += 1
+                    handle(index, scan_data, Path(scan_data["source"]))
+            results["total"] = index
+            files_to_submit = []
+        else:
+            files_to_submit = files
+        
+        for i, file_path in enumerate(files_to_submit, 1):
+            if not use_pool:
+                handle(i, None)
+                continue
+            
+            self.submit(file_path, i)
+            ready = self.poll()
+            while ready is not None:
+                handle(*ready)
+                ready = self.poll()
+        
+        # Дожидаемся оставшихся результатов
+        ready = self.poll(timeout_ms=None) if use_pool else None
+        while ready is not None:
+            handle(*ready)
+            ready = self.poll(timeout_ms=None)
+        
+        results["details"] = [details[i] for i in sorted(details)]
+        
+        # Excel строится один раз на всю папку
+        self.export_excel()
         
         print(f"\n{'='*50}")
         print(f"✅ ОБРАБОТКА ЗАВЕРШЕНА")
@@ -558,23 +1211,129 @@ class MuzlotoScanner:
         
         return results
     
+    def watch_folder(self,
+                     folder_path: str,
+                     operator: str = "Наблюдение за папкой",
+                     batch_size: int = 0,
+                     until_idle: bool = False) -> Dict[str, Any]:
+        """
+        Загружает анкеты из папки, в которую продолжают поступать сканы:
+        сначала те, что уже лежат в папке, затем новые по мере появления.
+        Строки пишутся в журнал пакетами. Журнал загрузки (рядом с
+        журналом результатов, ".ingest") хранит хеши содержимого
+        записанных файлов, поэтому повторный запуск продолжает с места
+        остановки, а копии уже загруженных сканов пропускаются.
+        
+        Args:
+            folder_path: Путь к папке со сканами
+            operator: Имя оператора
+            batch_size: Анкет в одном пакете (0 - JOURNAL_BATCH_ROWS)
+            until_idle: Вернуться, когда новых файлов нет, вместо
+                ожидания (Ctrl+C тоже останавливает наблюдение)
+            
+        Returns:
+            Статистика загрузки
+        """
+        folder = Path(folder_path)
+        if not folder.is_dir():
+            return {
+                "success": False,
+                "message": f"Папка не найдена: {folder_path}",
+                "processed": 0
+            }
+        
+        # Загрузка идёт в локальном ядре даже при подключенном демоне:
+        # журнал и кэш результатов - в этом процессе
+        self._ensure_pool()
+        self._flush_rows()
+        
+        keys = [self.INGEST_COLUMN_KEYS.get(name, "=") for name in
+                self.FIELD_NAMES]
+        keys[self.FIELD_NAMES.index("Оператор")] = "=" + operator
+        keys[self.FIELD_NAMES.index("Комментарий")] = "=Загрузка папки"
+        encoded = [key.encode('utf-8') for key in keys]
+        keys_array = (ctypes.c_char_p * len(encoded))(*encoded)
+        ingest_file = self.journal_file.with_suffix('.ingest')
+        
+        ingest = self.lib.muzloto_ingest_open(
+            self.pool_ptr, self.sink_ptr, str(folder).encode('utf-8'),
+            str(ingest_file).encode('utf-8'), keys_array, len(encoded),
+            batch_size if batch_size > 0 else self.JOURNAL_BATCH_ROWS)
+        if not ingest:
+            raise RuntimeError(f"Не удалось начать загрузку папки: {folder}")
+        
+        print(f"\n👀 Наблюдение за папкой: {folder_path}")
+        print(f"  Журнал загрузки: {ingest_file}")
+        
+        totals = {"committed": 0, "failed": 0, "skipped": 0,
+                  "cache_hits": 0}
+        try:
+            waiting = 0
+            while True:
+                # Недописанным файлам и повторному чтению даём время
+                timeout = 0 if until_idle and not waiting else 1000
+                step = self._take_json(self.lib.muzloto_ingest_step(
+                    ingest, timeout))
+                if not step.get("success", False):
+                    raise RuntimeError(step.get("error_message", ""))
+                for key in totals:
+                    totals[key] += step[key]
+                retrying = step["retrying"]
+                waiting = retrying + step["settling"]
+                
+                self.stats["total"] += step["committed"]
+                self.stats["failed"] += step["failed"]
+                self.stats["success"] += step["succeeded"]
+                if step["committed"] > 0 or step["failed"] > 0:
+                    print(f"✓ Записано: {step['committed']} "
+                          f"(ошибок: {step['failed']}, из кэша: "
+                          f"{step['cache_hits']}), в очереди: "
+                          f"{step['pending']}, к повтору: {retrying}")
+                
+                if not step["watching"]:
+                    print("⚠ Наблюдение за папкой прервалось")
+                    break
+                if (until_idle and step["pending"] == 0 and waiting == 0
+                        and step["committed"] == 0 and step["skipped"] == 0):
+                    break
+        except KeyboardInterrupt:
+            print("\nНаблюдение остановлено")
+        finally:
+            self.lib.muzloto_ingest_close(ingest)
+        
+        self.export_excel()
+        
+        print(f"\n{'='*50}")
+        print(f"✅ ЗАГРУЗКА ПАПКИ ЗАВЕРШЕНА")
+        print(f"   Записано: {totals['committed']}")
+        print(f"   С ошибками: {totals['failed']}")
+        print(f"   Пропущено (уже загружены): {totals['skipped']}")
+        print(f"   Файл с результатами: {self.excel_file}")
+        print(f"{'='*50}")
+        
+        return {"success": True, **totals}
+    
     def get_statistics(self) -> Dict[str, Any]:
         """Возвращает статистику обработки."""
-        # Читаем Excel файл для дополнительной статистики
+        # Читаем журнал для дополнительной статистики
         try:
-            df = pd.read_excel(self.excel_file, sheet_name=0)
+            self._flush_rows()
+            df = pd.read_csv(self.journal_file, encoding='utf-8-sig',
+                             dtype=str, keep_default_na=False)
             total_rows = len(df)
             success_rows = len(df[df['Статус обработки'] == 'Успешно'])
             
             # Статистика по датам
             if 'Дата заполнения' in df.columns:
-                dates = df['Дата заполнения'].dropna().unique()
+                dates = df.loc[df['Дата заполнения'] != '',
+                               'Дата заполнения'].unique()
                 date_stats = len(dates)
             else:
                 date_stats = 0
             
             return {
                 "excel_file": str(self.excel_file),
+                "journal_file": str(self.journal_file),
                 "total_records": total_rows,
                 "successful_records": success_rows,
                 "processing_stats": self.stats,
@@ -590,5 +1349,13 @@ class MuzlotoScanner:
     
     def __del__(self):
         """Очистка ресурсов при удалении объекта."""
-        if hasattr(self, 'scanner_ptr') and self.scanner_ptr:
+        if getattr(self, 'sink_ptr', None):
+            try:
+                self._flush_rows()
+            except Exception:
+                pass
+            self.lib.muzloto_sink_close(self.sink_ptr)
+        if getattr(self, 'pool_ptr', None):
+            self.lib.muzloto_pool_destroy(self.pool_ptr)
+        if getattr(self, 'scanner_ptr', None):
             self.lib.muzloto_destroy(self.scanner_ptr)